@@ -8,12 +8,14 @@
 #'  @param simfname file name of the simulation parameters  
 #'  @param parfname file name of the model parameters  
 #'  @param outfname file name of the output file   
+#'  @param set parameters changed without rewriting the files, e.g. c("omega[2,3]=0.5","tau=0.005")
 #'  
 # 
-run_snim <-function(simfname,parfname,outfname,spnames=""){
+run_snim <-function(simfname,parfname,outfname,spnames="",set=character(0)){
   if(!exists("snimBin")) stop("Variable snimBin not set")
   
-  system(paste(snimBin,simfname,parfname,outfname))
+  sets <- paste(paste("--set",shQuote(set)),collapse=" ")
+  system(paste(snimBin,sets,simfname,parfname,outfname))
   
   if(file.exists(outfname))
   require(tidyr)
@@ -32,6 +34,26 @@ run_snim <-function(simfname,parfname,outfname,spnames=""){
 }
 
 
+#'
+#'  Function to run a snim model with outputFormat = long in the simulation parameters, 
+#'  the output is already in long format (Species, Time, Density) and names come from the model file 
+#'  
+#'  @param simfname file name of the simulation parameters  
+#'  @param parfname file name of the model parameters  
+#'  @param outfname file name of the output file   
+#'  
+# 
+run_snim_long <-function(simfname,parfname,outfname){
+  if(!exists("snimBin")) stop("Variable snimBin not set")
+  
+  system(paste(snimBin,simfname,parfname,outfname))
+  
+  out <- read.delim(outfname, colClasses=c("character","numeric","numeric"))
+
+ return(out) 
+}
+
+
 #'
 #'  Function to run and plot species of snim model, it uses a global variable snimBin to execute the snim binary  
 #'  
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include "abc.h"
+#include "threadpool.h"
+#include "configfile.h"
+
+namespace snim {
+
+/// Read ABC parameters from configuration file
+///
+AbcParameters::AbcParameters(const std::string &fName){
+
+    ConfigFile cfg(fName);
+    modelFile    = cfg.getValueOfKey<std::string>("model");
+    simFile      = cfg.getValueOfKey<std::string>("simulation");
+    outPrefix    = cfg.getValueOfKey<std::string>("output", "abc");
+    smc          = cfg.getValueOfKey<std::string>("method", "rejection") == "smc";
+    nThreads     = cfg.getValueOfKey<size_t>("threads", 0);
+    pinThreads   = cfg.getValueOfKey<int>("pinThreads", 0) != 0;
+    nParticles   = cfg.getValueOfKey<size_t>("nParticles", 100);
+    replicates   = cfg.getValueOfKey<size_t>("replicates", 1);
+    maxProposals = cfg.getValueOfKey<size_t>("maxProposals", 1000000);
+    priorMin     = cfg.getValueOfKey<double>("priorMin", 0.0);
+    priorMax     = cfg.getValueOfKey<double>("priorMax", 1.0);
+    fromTime     = cfg.getValueOfKey<size_t>("fromTime", 0);
+    rndSeed      = cfg.getValueOfKey<size_t>("rndSeed", 0);
+
+    useS = cfg.keyExists("observedS");
+    useH = cfg.keyExists("observedH");
+    observed.S = cfg.getValueOfKey<double>("observedS", 0.0);
+    observed.H = cfg.getValueOfKey<double>("observedH", 0.0);
+
+    std::istringstream strline(cfg.getValueOfKey<std::string>("tolerance"));
+    double tempd=0;
+    while (strline >> tempd)
+        tolerance.push_back(tempd);
+
+    if (modelFile.empty() || simFile.empty())
+        throw std::invalid_argument("ABC parameters [" + fName + "] need model and simulation files");
+    if (!useS && !useH)
+        throw std::invalid_argument("ABC parameters [" + fName + "] need observedS or observedH");
+    if (tolerance.empty())
+        throw std::invalid_argument("ABC parameters [" + fName + "] need at least one tolerance");
+    if (!(priorMax > priorMin))
+        throw std::invalid_argument("ABC parameters [" + fName + "] priorMax must be greater than priorMin");
+}
+
+double AbcParameters::Distance(const SummaryStats &sim) const {
+    double d = 0.0;
+    if (useS)
+        d += (sim.S - observed.S) * (sim.S - observed.S);
+    if (useH)
+        d += (sim.H - observed.H) * (sim.H - observed.H);
+    return std::sqrt(d);
+}
+
+AbcEngine::AbcEngine(const SnimModel &mdl, const SimulationParameters &simPar, const AbcParameters &abcPar) :
+    base(mdl), sp(simPar), ap(abcPar), index(mdl.GetInteractionIndex()) {
+
+    // Summary statistics are calculated from the whole trajectory, the
+    // parallel runs keep no checkpoints
+    sp.RecordAll();
+    sp.checkpointEvery = 0;
+
+    if (index.empty())
+        throw std::invalid_argument("ABC: the model has no positive interactions to estimate");
+    if (!ap.smc)
+        ap.tolerance.resize(1);
+}
+
+/// Each generation proposes particles in batches that are simulated in
+/// parallel, every worker keeps its own copy of the model and only the
+/// estimated coefficients are overwritten for each proposal. Proposals and
+/// seeds are drawn in the calling thread, so the accepted particles do not
+/// depend on the number of threads.
+///
+std::vector<AbcParticle> AbcEngine::Run(std::ostream *out){
+    using namespace std;
+
+    auto rng = std::mt19937_64(ap.rndSeed);
+    if (ap.rndSeed == 0) {
+        std::random_device rd{};
+        rng.seed(rd());
+    }
+
+    // Workspaces are created by their worker (NUMA first touch when pinned)
+    //
+    ThreadPool pool(ap.nThreads, ap.pinThreads);
+    vector< unique_ptr<SnimModel> > mdl(pool.size());
+    vector< unique_ptr<StatsSink> > wStats(pool.size());
+    pool.RunOnEach([&](size_t w){
+        mdl[w].reset(new SnimModel(base));
+        mdl[w]->Compile();
+        wStats[w].reset(new StatsSink(ap.fromTime));
+    });
+
+    size_t const nPar = index.size();
+    size_t const batch = 256;                   // Fixed, so results don't depend on threads
+    vector< vector<double> > thetas;
+    vector<size_t> seeds;
+    vector<SummaryStats> stats;
+
+    auto simulateBatch = [&](){
+        stats.assign(thetas.size(), SummaryStats());
+        pool.Run(thetas.size(), [&](size_t job, size_t w){
+            for (size_t k = 0; k < nPar; ++k)
+                mdl[w]->SetOmega(index[k].first, index[k].second, thetas[job][k]);
+            mdl[w]->Compile();          // Again only if a channel appeared or disappeared
+
+            SimulationParameters jsp(sp);
+            for (size_t r = 0; r < ap.replicates; ++r) {
+                jsp.rndSeed = seeds[job] + r;
+                mdl[w]->SimulTauLeap(jsp, *wStats[w]);
+                auto st = wStats[w]->Summary();
+                stats[job].S += st.S / ap.replicates;
+                stats[job].H += st.H / ap.replicates;
+            }
+        });
+    };
+
+    auto prior = std::uniform_real_distribution<double>(ap.priorMin, ap.priorMax);
+    auto unif  = std::uniform_real_distribution<double>(0.0, 1.0);
+    auto norm  = std::normal_distribution<double>(0.0, 1.0);
+
+    vector<AbcParticle> pop, prev;
+    vector<double> sigma(nPar);
+
+    for (size_t gen = 0; gen < ap.tolerance.size(); ++gen) {
+
+        // Perturbation kernel: twice the weighted variance of the previous population
+        //
+        vector<double> cumW;
+        if (gen > 0) {
+            double acc = 0;
+            for (auto const &p : prev) {
+                acc += p.weight;
+                cumW.push_back(acc);
+            }
+            for (size_t k = 0; k < nPar; ++k) {
+                double m = 0, v = 0;
+                for (auto const &p : prev)
+                    m += p.weight * p.theta[k];
+                for (auto const &p : prev)
+                    v += p.weight * (p.theta[k] - m) * (p.theta[k] - m);
+                sigma[k] = std::sqrt(2.0 * v);
+                if (sigma[k] <= 0)
+                    sigma[k] = (ap.priorMax - ap.priorMin) * 1e-3;
+            }
+        }
+
+        pop.clear();
+        size_t proposals = 0;
+        while (pop.size() < ap.nParticles) {
+            if (proposals >= ap.maxProposals) {
+                std::ostringstream message;
+                message << "ABC: maximum number of proposals reached in generation " << gen
+                        << " with " << pop.size() << " accepted particles.";
+                throw std::runtime_error(message.str());
+            }
+
+            thetas.clear();
+            seeds.clear();
+            while (thetas.size() < batch && proposals < ap.maxProposals) {
+                ++proposals;
+                vector<double> th(nPar);
+                if (gen == 0) {
+                    for (auto &t : th)
+                        t = prior(rng);
+                }
+                else {
+                    auto j = std::lower_bound(cumW.begin(), cumW.end(), unif(rng) * cumW.back()) - cumW.begin();
+                    if (j >= static_cast<long>(prev.size()))
+                        j = prev.size() - 1;
+                    bool inside = true;
+                    for (size_t k = 0; k < nPar; ++k) {
+                        th[k] = prev[j].theta[k] + sigma[k] * norm(rng);
+                        if (th[k] < ap.priorMin || th[k] > ap.priorMax)
+                            inside = false;
+                    }
+                    if (!inside)
+                        continue;
+                }
+                size_t seed = rng();
+                seeds.push_back(seed == 0 ? 1 : seed);
+                thetas.push_back(th);
+            }
+
+            simulateBatch();
+
+            for (size_t i = 0; i < thetas.size() && pop.size() < ap.nParticles; ++i) {
+                double d = ap.Distance(stats[i]);
+                if (d > ap.tolerance[gen])
+                    continue;
+
+                AbcParticle p;
+                p.theta = thetas[i];
+                p.distance = d;
+                p.stats = stats[i];
+                if (gen > 0) {
+                    // The prior is uniform so only the kernel density is needed
+                    double den = 0;
+                    for (auto const &q : prev) {
+                        double lk = 0;
+                        for (size_t k = 0; k < nPar; ++k) {
+                            double z = (p.theta[k] - q.theta[k]) / sigma[k];
+                            lk += -0.5 * z * z - std::log(sigma[k]);
+                        }
+                        den += q.weight * std::exp(lk);
+                    }
+                    p.weight = den > 0 ? 1.0 / den : 0.0;
+                }
+                pop.push_back(p);
+            }
+        }
+
+        double sumW = 0;
+        for (auto const &p : pop)
+            sumW += p.weight;
+        for (auto &p : pop)
+            p.weight /= sumW;
+
+        if (out) {
+            for (size_t i = 0; i < pop.size(); ++i) {
+                *out << gen << "\t" << i << "\t" << pop[i].weight << "\t" << pop[i].distance
+                     << "\t" << pop[i].stats.S << "\t" << pop[i].stats.H;
+                for (auto t : pop[i].theta)
+                    *out << "\t" << t;
+                *out << "\n";
+            }
+            out->flush();
+        }
+
+        prev.swap(pop);
+    }
+
+    if (ap.pinThreads)
+        pool.Report(std::cout);
+
+    return prev;
+}
+
+/// Run ABC from a configuration file, the accepted particles of each
+/// generation are written to <output>.particles
+///
+void RunAbc(const std::string &fName, const SweepSpec &overrides){
+    AbcParameters ap(fName);
+
+    SnimModel mdl;
+    mdl.ReadModelParams(ap.modelFile);
+    SimulationParameters sp(ap.simFile);
+    overrides.ApplyJob(0, mdl, sp);
+    mdl.Compile();                      // Shared by the workers, that patch their copies
+
+    AbcEngine abc(mdl, sp, ap);
+
+    std::ofstream fout(ap.outPrefix + ".particles");
+    if (!fout)
+        throw std::runtime_error("ABC: can't open output file " + ap.outPrefix + ".particles");
+
+    fout << "generation\tparticle\tweight\tdistance\tS\tH";
+    auto idx = mdl.GetInteractionIndex();
+    for (auto const &rc : idx)
+        fout << "\tomega[" << rc.first << "," << rc.second << "]";
+    fout << "\n";
+
+    abc.Run(&fout);
+}
+
+} // end namespace
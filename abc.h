@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   abc.h
+  \brief  Approximate Bayesian Computation of the interaction coefficients
+ */
+#ifndef SNIM_ABC_HH_
+#define SNIM_ABC_HH_
+
+#include <string>
+#include <vector>
+
+#include "snim.h"
+#include "stats.h"
+#include "sweep.h"
+
+namespace snim {
+
+/**
+  \brief ABC settings read from a configuration file
+
+  File structure, name = value # comment:
+
+      model        = model.par          # Base model, its positive omega(i,j) i,j>0 are estimated
+      simulation   = easyABC.cfg        # Simulation parameters
+      output       = abc                # Accepted particles go to abc.particles
+      method       = smc                # rejection or smc
+      threads      = 0                  # 0 means all the cores
+      pinThreads   = 0                  # 1 pins workers to CPUs, NUMA local buffers
+      nParticles   = 1000               # Accepted particles of each generation
+      replicates   = 1                  # Simulations averaged for each particle
+      maxProposals = 1000000            # Proposals allowed for each generation
+      priorMin     = 0                  # Uniform prior of each coefficient
+      priorMax     = 5
+      observedS    = 12                 # Observed statistics, a missing one is not used
+      observedH    = 1.9
+      fromTime     = 50                 # Evaluation from which statistics are calculated
+      tolerance    = 1 0.5 0.25         # One tolerance for each generation
+      rndSeed      = 0
+ */
+struct AbcParameters {
+    std::string modelFile;
+    std::string simFile;
+    std::string outPrefix="abc";
+    bool smc=false;
+    size_t nThreads=0;
+    bool pinThreads=false;
+    size_t nParticles=100;
+    size_t replicates=1;
+    size_t maxProposals=1000000;
+    double priorMin=0.0;
+    double priorMax=1.0;
+    bool useS=false;
+    bool useH=false;
+    SummaryStats observed;
+    size_t fromTime=0;
+    std::vector<double> tolerance;
+    size_t rndSeed=0;
+
+    AbcParameters() {}
+
+    AbcParameters(const std::string &fName);
+
+    /// Euclidean distance between simulated and observed statistics
+    ///
+    double Distance(const SummaryStats &sim) const;
+};
+
+/**
+  \brief An accepted parameter vector
+ */
+struct AbcParticle {
+    std::vector<double> theta;
+    double weight=1.0;
+    double distance=0.0;
+    SummaryStats stats;
+};
+
+/**
+  \brief ABC rejection and ABC-SMC (Beaumont et al. 2009) over the positive
+         interaction coefficients of a model
+ */
+class AbcEngine {
+    const SnimModel &base;
+    SimulationParameters sp;
+    AbcParameters ap;
+    std::vector< std::pair<size_t,size_t> > index;   // Position in omega of each parameter
+
+public:
+    AbcEngine(const SnimModel &mdl, const SimulationParameters &simPar, const AbcParameters &abcPar);
+
+    /// Number of parameters estimated
+    ///
+    size_t size() const { return index.size(); }
+
+    /// Run all the generations, the accepted particles of each generation are
+    /// passed to the optional stream
+    ///
+    std::vector<AbcParticle> Run(std::ostream *out=nullptr);
+};
+
+/// Read the ABC configuration and model, run it and write <output>.particles
+///
+/// \param overrides values set in the model and simulation parameters
+///                  before the estimation (--set)
+///
+void RunAbc(const std::string &fName, const SweepSpec &overrides = SweepSpec());
+
+} /* end namespace */
+
+#endif
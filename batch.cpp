@@ -0,0 +1,180 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include "batch.h"
+#include "mappedfile.h"
+#include "sweep.h"
+#include "textscan.h"
+#include "threadpool.h"
+
+namespace snim {
+
+std::vector<BatchJob> ReadManifest(const std::string &fName){
+    MappedFile file(fName);
+    LineScanner lines(file.data(), file.size());
+    std::vector<BatchJob> jobs;
+    const char *begin, *end;
+    while (lines.Next(begin, end)) {
+        std::vector<std::string> fields;
+        for (const char *p = begin; p < end; ) {
+            const char *tab = p;
+            while (tab < end && *tab != '\t')
+                ++tab;
+            const char *fBegin = SkipSpaces(p, tab), *fEnd = tab;
+            while (fEnd > fBegin && IsSpace(fEnd[-1]))
+                --fEnd;
+            if (fBegin < fEnd)
+                fields.emplace_back(fBegin, fEnd);
+            p = tab + 1;
+        }
+        if (fields.empty())
+            continue;
+        if (fields.size() < 3)
+            throw std::invalid_argument("Manifest [" + fName + "] line " + std::to_string(lines.LineNo()) +
+                                        ": expected model, simulation and output files");
+
+        BatchJob job;
+        job.line = lines.LineNo();
+        job.modelFile = fields[0];
+        job.simFile = fields[1];
+        job.outFile = fields[2];
+        job.overrides.assign(fields.begin() + 3, fields.end());
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+/// Overrides are a sweep of one point
+///
+static SweepSpec Overrides(const BatchJob &job){
+    SweepSpec spec;
+    for (auto const &ov : job.overrides)
+        spec.AddOverride(ov);
+    return spec;
+}
+
+std::vector<BatchStatus> RunBatch(const std::vector<BatchJob> &jobs, size_t nThreads){
+    using namespace std;
+
+    // Models shared by the jobs, read in parallel. A model is read with the
+    // cache if the first job that uses it asks for it.
+    //
+    map<string, size_t> modelIndex;
+    vector<size_t> jobModel(jobs.size());
+    vector<string> modelFiles;
+    vector<bool> useCache;
+    vector<shared_ptr<SnimModel>> models;
+    vector<string> modelError;
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        auto const &job = jobs[j];
+        auto it = modelIndex.find(job.modelFile);
+        if (it != modelIndex.end()) {
+            jobModel[j] = it->second;
+            continue;
+        }
+        jobModel[j] = modelIndex[job.modelFile] = modelFiles.size();
+        modelFiles.push_back(job.modelFile);
+        bool cache = false;
+        try {
+            NetworkParameters np(job.simFile);
+            if (np.Active() && job.modelFile == "-")
+                modelFiles.back().clear();
+            cache = SimulationParameters(job.simFile).modelCache;
+        }
+        catch (const std::exception &) {
+            // Reported by the job
+        }
+        useCache.push_back(cache);
+    }
+    models.resize(modelFiles.size());
+    modelError.resize(modelFiles.size());
+
+    ThreadPool pool(nThreads);
+    pool.Run(modelFiles.size(), [&](size_t m, size_t){
+        if (modelFiles[m].empty())
+            return;                     // Generated by each job
+        try {
+            shared_ptr<SnimModel> mdl(new SnimModel());
+            if (useCache[m])
+                mdl->ReadModelParamsCached(modelFiles[m], modelFiles[m] + ".snc");
+            else
+                mdl->ReadModelParams(modelFiles[m]);
+            mdl->Compile();
+            models[m] = mdl;
+        }
+        catch (const std::exception &e) {
+            modelError[m] = e.what();
+        }
+    });
+
+    vector<BatchStatus> status(jobs.size());
+    pool.Run(jobs.size(), [&](size_t j, size_t){
+        auto t0 = chrono::steady_clock::now();
+        auto const &job = jobs[j];
+        try {
+            size_t m = jobModel[j];
+            SimulationParameters sp(job.simFile);
+            NetworkParameters np(job.simFile);
+
+            shared_ptr<const SnimModel> mdl = models[m];
+            if (np.Active()) {
+                shared_ptr<SnimModel> gen(new SnimModel());
+                gen->GenerateNetwork(np);
+                mdl = gen;
+            }
+            else if (!mdl)
+                throw std::runtime_error(modelError[m].empty() ? "No model" : modelError[m]);
+
+            if (!job.overrides.empty()) {
+                shared_ptr<SnimModel> copy(new SnimModel(*mdl));
+                Overrides(job).ApplyJob(0, *copy, sp);
+                mdl = copy;
+            }
+
+            // Each job has its own checkpoint, to continue it with --resume
+            if (sp.checkpointEvery > 0)
+                sp.checkpointFile = job.outFile + ".chk";
+
+            // The output is formatted and written in another thread
+            AsyncSink out(MakeOutputSink(*mdl, sp, job.outFile));
+            mdl->SimulTauLeap(sp, out);
+            status[j].ok = true;
+        }
+        catch (const std::exception &e) {
+            status[j].message = e.what();
+        }
+        status[j].seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    });
+    return status;
+}
+
+void WriteBatchStatus(const std::string &fName, const std::vector<BatchJob> &jobs,
+                      const std::vector<BatchStatus> &status){
+    std::ofstream os(fName);
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+    os << "line\tmodel\tsimulation\toutput\tstatus\tseconds\tmessage\n";
+    for (size_t j = 0; j < jobs.size(); ++j)
+        os << jobs[j].line << "\t" << jobs[j].modelFile << "\t" << jobs[j].simFile << "\t"
+           << jobs[j].outFile << "\t" << (status[j].ok ? "ok" : "failed") << "\t"
+           << status[j].seconds << "\t" << status[j].message << "\n";
+}
+
+} // end namespace
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+  \file   batch.h
+  \brief  Batches of independent simulations listed in a manifest, run in one
+          process with the models shared between jobs
+ */
+#ifndef SNIM_BATCH_HH_
+#define SNIM_BATCH_HH_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "snim.h"
+#include "trajectory.h"
+
+namespace snim {
+
+/**
+  \brief One line of a manifest
+ */
+struct BatchJob {
+    size_t line=0;                          /// Line of the manifest, from 1
+    std::string modelFile;                  /// - if the simulation file has a network
+    std::string simFile;
+    std::string outFile;
+    std::vector<std::string> overrides;     /// key=value with the keys of a sweep axis
+};
+
+/**
+  \brief Result of a job, as written to the status file
+ */
+struct BatchStatus {
+    bool ok=false;
+    double seconds=0.0;
+    std::string message;                    /// Error of a failed job
+};
+
+/// Read a manifest: tab separated lines with the model file, the simulation
+/// file, the output file and optional overrides, one by field, with the keys
+/// of a sweep axis:
+///
+///     # model       simulation    output        overrides
+///     model.par     sim.cfg       out1.txt
+///     model.par     sim.cfg       out2.txt      e[2]=0.5   tau=0.005
+///     big.par       sim.cfg       out3.trj      iniCond=10 20 30
+///
+/// Lines starting with # and blank lines are skipped.
+///
+std::vector<BatchJob> ReadManifest(const std::string &fName);
+
+/// Run the jobs on a thread pool. Each model file is read once and shared by
+/// its jobs; jobs with overrides use a copy. A failed job does not stop the
+/// others.
+///
+/// \param nThreads 0 uses all the cores
+/// \return status of each job, in the order of the manifest
+///
+std::vector<BatchStatus> RunBatch(const std::vector<BatchJob> &jobs, size_t nThreads=0);
+
+/// Write the status of the jobs as a tab separated file, one line per job
+///
+void WriteBatchStatus(const std::string &fName, const std::vector<BatchJob> &jobs,
+                      const std::vector<BatchStatus> &status);
+
+} /* end namespace */
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compare the parsing of a dense model file line by line with getline and
+// istringstream, the previous reader, with SnimModel::ReadModelParams
+//
+//   benchParse [species] [density] [file]
+//
+// The default is a model of 2000 species with 10% of the interactions
+// present. The parsing of a configuration file is also timed.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include "snim.h"
+#include "configfile.h"
+
+using namespace std;
+using namespace snim;
+
+static double Seconds(chrono::steady_clock::time_point t0){
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// The reader before textscan.h, only the interaction matrix is kept
+//
+static double ReadWithStreams(const string &fName, size_t &nonZeros){
+    ifstream file(fName);
+    string line;
+    size_t lineNo = 0, nSpecies = 0;
+    double sum = 0;
+    nonZeros = 0;
+    while (getline(file, line)) {
+        string temp = line;
+        if (temp.find('#') != temp.npos)
+            temp.erase(temp.find('#'));
+        if (temp.find_first_not_of(' ') == temp.npos)
+            continue;
+        istringstream strline(temp);
+        double v;
+        if (++lineNo == 1)
+            strline >> nSpecies;
+        else if (lineNo > 3)
+            for (size_t i = 0; i <= nSpecies && strline >> v; ++i)
+                if (v != 0) {
+                    sum += float(v);
+                    ++nonZeros;
+                }
+    }
+    return sum;
+}
+
+int main(int argc, char * argv[]) {
+    size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    double density = argc > 2 ? atof(argv[2]) : 0.1;
+    string fName = argc > 3 ? argv[3] : "benchParse.par";
+    string cfgName = fName + ".cfg";
+
+    // Rates written like the R functions, with a few exponents
+    {
+        ofstream os(fName);
+        os << setprecision(8);
+        mt19937 rng(1);
+        uniform_real_distribution<double> unif(0, 1);
+        os << n << " 1000000\n";
+        for (int l = 0; l < 2; ++l) {
+            for (size_t i = 0; i < n; ++i)
+                os << (i ? " " : "") << unif(rng) * 0.01;
+            os << "\n";
+        }
+        for (size_t r = 0; r <= n; ++r) {
+            for (size_t c = 0; c <= n; ++c) {
+                double v = unif(rng) < density ? unif(rng) : 0.0;
+                os << (c ? " " : "");
+                if (v == 0)
+                    os << '0';
+                else if (c % 7 == 0)
+                    os << scientific << v << defaultfloat;
+                else
+                    os << v;
+            }
+            os << "\n";
+        }
+        ofstream cs(cfgName);
+        cs << "# Simulation parameters\nrndSeed = 1\nnEvals = 1000   # evaluations\ntau = 0.1\n"
+              "outputFormat = stream\nrecordStart = 10\nrecordStride = 2\n"
+              "iniCond = 0 10 20 30 40 50 60 70 80 90\n";
+    }
+    ifstream is(fName, ios::binary | ios::ate);
+    double mb = is.tellg() / 1e6;
+
+    auto t0 = chrono::steady_clock::now();
+    size_t nnzOld = 0;
+    double sumOld = ReadWithStreams(fName, nnzOld);
+    double tOld = Seconds(t0);
+
+    t0 = chrono::steady_clock::now();
+    SnimModel mdl;
+    mdl.ReadModelParams(fName);
+    double tNew = Seconds(t0);
+
+    double sumNew = 0;
+    size_t nnzNew = 0;
+    for (size_t r = 0; r <= n; ++r)
+        for (size_t c = 0; c <= n; ++c)
+            if (mdl.GetOmega(r,c) != 0) {
+                sumNew += mdl.GetOmega(r,c);
+                ++nnzNew;
+            }
+
+    const int cfgReps = 10000;
+    t0 = chrono::steady_clock::now();
+    size_t seeds = 0;
+    for (int i = 0; i < cfgReps; ++i)
+        seeds += SimulationParameters(cfgName).rndSeed;
+    double tCfg = Seconds(t0);
+
+    remove(fName.c_str());
+    remove(cfgName.c_str());
+
+    cout << n << " species, " << mb << " MB, " << nnzNew << " interactions" << endl;
+    cout << "istringstream     " << tOld << " s  " << mb / tOld << " MB/s" << endl;
+    cout << "ReadModelParams   " << tNew << " s  " << mb / tNew << " MB/s" << endl;
+    cout << "speedup           " << tOld / tNew << endl;
+    cout << "same values       " << (sumOld == sumNew && nnzOld == nnzNew ? "yes" : "NO") << endl;
+    cout << "config files      " << cfgReps / tCfg << " per second" << (seeds == cfgReps ? "" : " WRONG") << endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compare the tab separated output of matrix::operator<< with WriteTsv
+//
+//   benchTsv [species] [evaluations] [file]
+//
+// The default is a trajectory of 1000 species and 100000 evaluations.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include "tsvwriter.h"
+
+using namespace std;
+using namespace snim;
+
+static double Seconds(chrono::steady_clock::time_point t0){
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char * argv[]) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    size_t cols = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+    string fName = argc > 3 ? argv[3] : "benchTsv.txt";
+
+    // Counts of a random walk, like the abundances of a simulation
+    matrix<size_t> m(rows, cols, size_t(0));
+    mt19937 rng(1);
+    uniform_int_distribution<int> step(-20, 20);
+    for (size_t r = 0; r < rows; ++r) {
+        long long v = rng() % 100000;
+        for (size_t c = 0; c < cols; ++c) {
+            v = max(0LL, v + step(rng));
+            m(r,c) = v;
+        }
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    {
+        ofstream os(fName);
+        os << m;
+    }
+    double tOld = Seconds(t0);
+
+    t0 = chrono::steady_clock::now();
+    {
+        ofstream os(fName, ios::binary);
+        WriteTsv(os, m);
+    }
+    double tNew = Seconds(t0);
+
+    ifstream is(fName, ios::binary | ios::ate);
+    double mb = is.tellg() / 1e6;
+    remove(fName.c_str());
+
+    cout << rows << " x " << cols << ", " << mb << " MB" << endl;
+    cout << "operator<<  " << tOld << " s  " << mb / tOld << " MB/s" << endl;
+    cout << "WriteTsv    " << tNew << " s  " << mb / tNew << " MB/s" << endl;
+    cout << "speedup     " << tOld / tNew << endl;
+    return 0;
+}
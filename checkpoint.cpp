@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "checkpoint.h"
+
+namespace snim {
+
+static const char checkMagic[8] = {'S','N','I','M','C','H','K','\0'};
+static const uint32_t checkVersion = 2;
+
+/// Recording settings after the state of the random generator, followed by
+/// the species recorded and the name of the output format
+///
+struct CheckpointLayout {
+    uint64_t recordStart;
+    uint64_t recordStride;
+    uint64_t nSpecies;
+    uint64_t formatBytes;
+};
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t modelHash;
+    uint64_t seed;
+    double tau;
+    uint64_t eval;
+    uint64_t col;
+    uint64_t outputSize;
+    uint64_t nRows;
+    uint64_t rngBytes;
+};
+
+void Checkpoint::Save(const std::string &fName) const {
+    CheckpointHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, checkMagic, sizeof(checkMagic));
+    h.version = checkVersion;
+    h.modelHash = modelHash;
+    h.seed = seed;
+    h.tau = tau;
+    h.eval = eval;
+    h.col = col;
+    h.outputSize = outputSize;
+    h.nRows = state.size();
+    h.rngBytes = rngState.size();
+
+    std::string tmp = fName + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary);
+        if (!os)
+            throw std::runtime_error("Can't open checkpoint file " + tmp);
+        os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        os.write(reinterpret_cast<const char*>(state.data()), state.size() * sizeof(uint64_t));
+        os.write(rngState.data(), rngState.size());
+
+        CheckpointLayout l = {recordStart, recordStride, recordSpecies.size(), outputFormat.size()};
+        os.write(reinterpret_cast<const char*>(&l), sizeof(l));
+        os.write(reinterpret_cast<const char*>(recordSpecies.data()), recordSpecies.size() * sizeof(uint64_t));
+        os.write(outputFormat.data(), outputFormat.size());
+        os.flush();
+        if (!os)
+            throw std::runtime_error("Error writing checkpoint file " + tmp);
+    }
+    if (std::rename(tmp.c_str(), fName.c_str()) != 0)
+        throw std::runtime_error("Can't rename checkpoint file " + tmp + " to " + fName);
+}
+
+void Checkpoint::Load(const std::string &fName){
+    std::ifstream is(fName, std::ios::binary);
+    if (!is)
+        throw std::runtime_error("Checkpoint file [" + fName + "] couldn't be opened");
+
+    CheckpointHeader h;
+    is.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (!is || std::memcmp(h.magic, checkMagic, sizeof(checkMagic)) != 0)
+        throw std::runtime_error("File [" + fName + "] is not a checkpoint file");
+    if (h.version > checkVersion)
+        throw std::runtime_error("File [" + fName + "] has an unknown version");
+
+    modelHash = h.modelHash;
+    seed = h.seed;
+    tau = h.tau;
+    eval = h.eval;
+    col = h.col;
+    outputSize = h.outputSize;
+    state.resize(h.nRows);
+    rngState.resize(h.rngBytes);
+    is.read(reinterpret_cast<char*>(state.data()), state.size() * sizeof(uint64_t));
+    is.read(&rngState[0], rngState.size());
+
+    recordStart = 0;
+    recordStride = 1;
+    recordSpecies.clear();
+    outputFormat.clear();
+    if (h.version >= 2) {
+        CheckpointLayout l;
+        is.read(reinterpret_cast<char*>(&l), sizeof(l));
+        if (is) {
+            recordStart = l.recordStart;
+            recordStride = l.recordStride;
+            recordSpecies.resize(l.nSpecies);
+            outputFormat.resize(l.formatBytes);
+            is.read(reinterpret_cast<char*>(recordSpecies.data()), recordSpecies.size() * sizeof(uint64_t));
+            is.read(&outputFormat[0], outputFormat.size());
+        }
+    }
+    if (!is)
+        throw std::runtime_error("Checkpoint file [" + fName + "] is truncated");
+}
+
+} // end namespace
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   checkpoint.h
+  \brief  State of a simulation saved to restart it
+ */
+#ifndef SNIM_CHECKPOINT_HH_
+#define SNIM_CHECKPOINT_HH_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace snim {
+
+/**
+  \brief Everything needed to continue a simulation exactly as if it had not
+         been interrupted.
+
+  Saved by SnimModel::SimulTauLeap every SimulationParameters::checkpointEvery
+  evaluations. The file is binary: a fixed header, the populations, the
+  state of the random generator in its standard text form and, from version
+  2, the settings that give the layout of the output.
+ */
+struct Checkpoint {
+    uint64_t modelHash=0;               /// SnimModel::Hash() of the model simulated
+    uint64_t seed=0;                    /// Seed of the run
+    double tau=0.0;
+    uint64_t eval=0;                    /// Evaluations done
+    uint64_t col=0;                     /// Columns passed to the output
+    uint64_t outputSize=0;              /// Bytes of the output file at the checkpoint
+    std::vector<uint64_t> state;        /// Individuals of each species, 0 is empty space
+    std::string rngState;
+    uint64_t recordStart=0;             /// Recording settings of the run, the output can
+    uint64_t recordStride=1;            /// only be continued with the same ones
+    std::vector<uint64_t> recordSpecies;
+    std::string outputFormat;           /// Empty if the checkpoint has no recording settings (version 1)
+
+    /// Write the checkpoint to a temporary file and rename it, so an
+    /// interruption while saving leaves the previous checkpoint
+    ///
+    void Save(const std::string &fName) const;
+
+    void Load(const std::string &fName);
+};
+
+} /* end namespace */
+
+#endif
@@ -0,0 +1,340 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/**
+  \file   compiledmodel.h
+  \brief  Form of the model used by the simulation: interaction channels with
+          their net rates and the channels of each species
+ */
+#ifndef SNIM_COMPILEDMODEL_HH_
+#define SNIM_COMPILEDMODEL_HH_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sparsematrix.h"
+
+namespace snim {
+
+/**
+  \brief One positive interaction omega(s,r): species s gains individuals
+         from r at rate net * S(s) * S(r) / communitySize when net > 0
+ */
+struct Channel {
+    uint32_t s;
+    uint32_t r;
+    float net;                          /// omega(s,r) - omega(r,s)
+};
+
+/**
+  \brief The channels of the interaction matrix in the order of its rows, and
+         the channels each species takes part in.
+
+  The channels of predator s are PredatorBegin(s) to PredatorEnd(s)-1, those
+  where k is the prey are listed by PreyBegin(k) to PreyEnd(k)-1. A change of
+  S(k) or of the row or column k of omega affects only those channels.
+
+  The arrays are owned or, like SparseMatrix, a view of a memory mapped file.
+ */
+class CompiledModel {
+    size_t n=0;                         // Species plus the empty space
+    size_t nCh=0;
+
+    std::vector<Channel> channelsV;
+    std::vector<uint64_t> predStartV, preyStartV;
+    std::vector<uint32_t> preyChannelsV;
+
+    const Channel *channels=nullptr;
+    const uint64_t *predStart=nullptr;
+    const uint64_t *preyStart=nullptr;
+    const uint32_t *preyChannels=nullptr;
+    std::shared_ptr<const void> owner;
+
+    void Point() {
+        if (owner)
+            return;
+        channels = channelsV.data();
+        predStart = predStartV.data();
+        preyStart = preyStartV.data();
+        preyChannels = preyChannelsV.data();
+    }
+
+    void Own() {
+        if (!owner)
+            return;
+        channelsV.assign(channels, channels + nCh);
+        predStartV.assign(predStart, predStart + n + 1);
+        preyStartV.assign(preyStart, preyStart + n + 1);
+        preyChannelsV.assign(preyChannels, preyChannels + nCh);
+        owner.reset();
+        Point();
+    }
+
+public:
+    CompiledModel() {}
+
+    /// Channels of the positive elements of omega with s >= 1, the empty
+    /// space (row 0) gains nothing from interactions
+    ///
+    explicit CompiledModel(const SparseMatrix &omega) : n(omega.rows()),
+        predStartV(n + 1, 0), preyStartV(n + 1, 0) {
+        for (size_t s = 1; s < n; ++s) {
+            for (size_t i = omega.RowBegin(s); i < omega.RowEnd(s); ++i)
+                if (omega.Value(i) > 0) {
+                    uint32_t r = omega.Col(i);
+                    channelsV.push_back({uint32_t(s), r, omega.Value(i) - omega(r, s)});
+                    ++preyStartV[r + 1];
+                }
+            predStartV[s + 1] = channelsV.size();
+        }
+        nCh = channelsV.size();
+
+        for (size_t k = 0; k < n; ++k)
+            preyStartV[k + 1] += preyStartV[k];
+        preyChannelsV.resize(nCh);
+        std::vector<uint64_t> next(preyStartV.begin(), preyStartV.end() - 1);
+        for (size_t c = 0; c < nCh; ++c)
+            preyChannelsV[next[channelsV[c].r]++] = c;
+        Point();
+    }
+
+    CompiledModel(const CompiledModel &m) : n(m.n), nCh(m.nCh), channelsV(m.channelsV),
+        predStartV(m.predStartV), preyStartV(m.preyStartV), preyChannelsV(m.preyChannelsV),
+        channels(m.channels), predStart(m.predStart), preyStart(m.preyStart),
+        preyChannels(m.preyChannels), owner(m.owner) { Point(); }
+
+    CompiledModel &operator=(const CompiledModel &) = delete;
+
+    /// Model that uses the arrays in place while owner is alive
+    ///
+    static std::shared_ptr<CompiledModel> View(size_t size, size_t nChannels, const Channel *channels,
+                                               const uint64_t *predStart, const uint64_t *preyStart,
+                                               const uint32_t *preyChannels, std::shared_ptr<const void> owner) {
+        std::shared_ptr<CompiledModel> m(new CompiledModel());
+        m->n = size;
+        m->nCh = nChannels;
+        m->channels = channels;
+        m->predStart = predStart;
+        m->preyStart = preyStart;
+        m->preyChannels = preyChannels;
+        m->owner = owner;
+        return m;
+    }
+
+    size_t Species() const { return n; }
+    size_t Channels() const { return nCh; }
+    bool IsView() const { return static_cast<bool>(owner); }
+
+    const Channel &operator[](size_t c) const { return channels[c]; }
+
+    size_t PredatorBegin(size_t s) const { return predStart[s]; }
+    size_t PredatorEnd(size_t s) const { return predStart[s + 1]; }
+    size_t PreyBegin(size_t k) const { return preyStart[k]; }
+    size_t PreyEnd(size_t k) const { return preyStart[k + 1]; }
+    uint32_t PreyChannel(size_t i) const { return preyChannels[i]; }
+
+    /// Channel of omega(s,r), Channels() if it has none
+    ///
+    size_t Find(size_t s, size_t r) const {
+        if (s == 0 || s >= n)
+            return nCh;
+        auto b = channels + predStart[s], e = channels + predStart[s + 1];
+        auto it = std::lower_bound(b, e, r, [](const Channel &c, size_t col){ return c.r < col; });
+        return (it != e && it->r == r) ? it - channels : nCh;
+    }
+
+    /// Change the net rate of a channel, a view is copied first
+    ///
+    void SetNet(size_t c, float net) {
+        Own();
+        channelsV[c].net = net;
+    }
+
+    /// The arrays, to write them to a file
+    ///
+    const Channel *ChannelArray() const { return channels; }
+    const uint64_t *PredatorStarts() const { return predStart; }
+    const uint64_t *PreyStarts() const { return preyStart; }
+    const uint32_t *PreyChannels() const { return preyChannels; }
+};
+
+/**
+  \brief Groups of species that interact with each other, directly or through
+         other species, the connected components of the channels between
+         species 1..n.
+
+  The empty space is left out: all the species can share it and it is the
+  only coupling between components. In one step of the simulation the rates
+  depend only on the state at the start of the step, so the components can
+  be sampled independently and only S(0) has to be updated after all of them.
+ */
+struct ModelComponents {
+    std::vector<uint32_t> component;    /// Component of each species, component[0] is not used
+    std::vector<uint64_t> start;        /// Species of component c are species[start[c]] to species[start[c+1]-1]
+    std::vector<uint32_t> species;      /// Species grouped by component, in increasing order in each one
+    std::vector<uint64_t> channels;     /// Channels of the predators of each component
+
+    size_t Count() const { return start.empty() ? 0 : start.size() - 1; }
+    size_t Size(size_t c) const { return start[c + 1] - start[c]; }
+    const uint32_t *Species(size_t c) const { return species.data() + start[c]; }
+};
+
+/// Connected components of the interaction graph, numbered in the order of
+/// their first species so the same model gives always the same numbers
+///
+inline ModelComponents FindComponents(const CompiledModel &cm) {
+    size_t n = cm.Species();
+    std::vector<uint32_t> parent(n);
+    for (size_t k = 0; k < n; ++k)
+        parent[k] = k;
+    auto root = [&](uint32_t k) {
+        while (parent[k] != k) {
+            parent[k] = parent[parent[k]];
+            k = parent[k];
+        }
+        return k;
+    };
+    for (size_t c = 0; c < cm.Channels(); ++c) {
+        if (cm[c].r == 0)
+            continue;
+        uint32_t a = root(cm[c].s), b = root(cm[c].r);
+        if (a != b)
+            parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    ModelComponents mc;
+    mc.component.assign(n, 0);
+    std::vector<uint32_t> number(n, UINT32_MAX);
+    std::vector<uint64_t> count;
+    for (size_t k = 1; k < n; ++k) {
+        uint32_t r = root(k);
+        if (number[r] == UINT32_MAX) {
+            number[r] = count.size();
+            count.push_back(0);
+        }
+        mc.component[k] = number[r];
+        ++count[number[r]];
+    }
+
+    mc.start.assign(count.size() + 1, 0);
+    for (size_t c = 0; c < count.size(); ++c)
+        mc.start[c + 1] = mc.start[c] + count[c];
+    mc.species.resize(n > 0 ? n - 1 : 0);
+    mc.channels.assign(count.size(), 0);
+    std::vector<uint64_t> next(mc.start.begin(), mc.start.end() - 1);
+    for (size_t k = 1; k < n; ++k) {
+        auto c = mc.component[k];
+        mc.species[next[c]++] = k;
+        mc.channels[c] += cm.PredatorEnd(k) - cm.PredatorBegin(k);
+    }
+    return mc;
+}
+
+/// Numbering of the species that keeps the ones that interact close, the
+/// reverse Cuthill-McKee ordering of the interaction graph. order[k] is the
+/// species that takes number k, the empty space keeps number 0.
+///
+/// Each component starts from a pseudo-peripheral species of low degree and
+/// is numbered by levels, neighbours of lower degree first, so the channels
+/// of a predator point to prey with numbers near its own and the
+/// populations read by consecutive channels are close in memory.
+///
+inline std::vector<uint32_t> BandwidthOrder(const CompiledModel &cm) {
+    size_t n = cm.Species();
+    std::vector<std::vector<uint32_t>> adj(n);
+    for (size_t c = 0; c < cm.Channels(); ++c) {
+        uint32_t s = cm[c].s, r = cm[c].r;
+        if (r == 0 || r == s)
+            continue;
+        adj[s].push_back(r);
+        adj[r].push_back(s);
+    }
+    for (auto &a : adj) {
+        std::sort(a.begin(), a.end());
+        a.erase(std::unique(a.begin(), a.end()), a.end());
+    }
+    for (auto &a : adj)
+        std::stable_sort(a.begin(), a.end(), [&](uint32_t x, uint32_t y){ return adj[x].size() < adj[y].size(); });
+
+    // Breadth first search from start over the species not yet numbered,
+    // appends them to out by levels with their depth
+    std::vector<uint32_t> mark(n, 0), depth(n, 0);
+    const uint32_t numbered = UINT32_MAX;
+    uint32_t pass = 0;
+    auto bfs = [&](uint32_t start, std::vector<uint32_t> &out) {
+        ++pass;
+        size_t first = out.size();
+        out.push_back(start);
+        mark[start] = pass;
+        depth[start] = 0;
+        for (size_t i = first; i < out.size(); ++i)
+            for (auto k : adj[out[i]])
+                if (mark[k] != pass && mark[k] != numbered) {
+                    mark[k] = pass;
+                    depth[k] = depth[out[i]] + 1;
+                    out.push_back(k);
+                }
+        return first;
+    };
+
+    std::vector<uint32_t> cmOrder, level;
+    cmOrder.reserve(n);
+    std::vector<uint32_t> byDegree(n > 0 ? n - 1 : 0);
+    for (size_t k = 1; k < n; ++k)
+        byDegree[k - 1] = k;
+    std::stable_sort(byDegree.begin(), byDegree.end(), [&](uint32_t x, uint32_t y){ return adj[x].size() < adj[y].size(); });
+
+    for (auto start : byDegree) {
+        if (mark[start] == numbered)
+            continue;
+
+        // Move the start to the species of lowest degree of the last level
+        // while that makes the search deeper
+        uint32_t longest = 0;
+        for (int it = 0; it < 8; ++it) {
+            level.clear();
+            bfs(start, level);
+            uint32_t d = depth[level.back()];
+            if (it > 0 && d <= longest)
+                break;
+            longest = d;
+            uint32_t next = level.back();
+            for (size_t i = level.size(); i-- > 0 && depth[level[i]] == d; )
+                if (adj[level[i]].size() <= adj[next].size())
+                    next = level[i];
+            if (next == start)
+                break;
+            start = next;
+        }
+
+        size_t first = bfs(start, cmOrder);
+        for (size_t i = first; i < cmOrder.size(); ++i)
+            mark[cmOrder[i]] = numbered;
+    }
+
+    std::vector<uint32_t> order(n, 0);
+    for (size_t k = 1; k < n; ++k)
+        order[k] = cmOrder[n - 1 - k];
+    return order;
+}
+
+} /* end namespace */
+
+#endif
@@ -27,21 +27,26 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <vector>
 #include <fstream>
 #include <typeinfo>
+#include <limits>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "mappedfile.h"
+#include "textscan.h"
 
 namespace snim {
 
 
-/// Function that shows an error and exits with failure
+/// Errors of the configuration files are thrown, so a program that reads
+/// many of them (sweeps, batches) can report the file and go on
 /// \param error
-void exitWithError(const std::string &error) 
+[[noreturn]] inline void throwConfigError(const std::string &error) 
 {
-	std::cout << error;
-	std::cin.ignore();
-	std::cin.get();
-
-	exit(EXIT_FAILURE);
+	throw std::runtime_error(error);
 };
 
 /// Class that use template functions to convert strings to other types  
@@ -66,121 +71,149 @@ public:
 		std::istringstream istr(val);
 		T returnVal;
 		if (!(istr >> returnVal))
-			exitWithError("CFG: Not a valid " + (std::string)typeid(T).name() + " received!\n");
+			notValid<T>(val);
 
 		return returnVal;
 	}
 
+private:
+
+	template <typename T>
+	[[noreturn]] static void notValid(std::string const &val)
+	{
+		throwConfigError("CFG: Not a valid " + (std::string)typeid(T).name() + " received [" + val + "]");
+	}
+
+	/// Integers are scanned in place, like operator>> leading spaces are
+	/// skipped and what follows the number is ignored
+	template <typename T>
+	static T scanInteger(std::string const &val)
+	{
+		const char *p = val.data();
+		if (std::numeric_limits<T>::is_signed) {
+			int64_t v;
+			if (!ScanSigned(p, p + val.size(), v) ||
+			    v < int64_t(std::numeric_limits<T>::min()) || v > int64_t(std::numeric_limits<T>::max()))
+				notValid<T>(val);
+			return static_cast<T>(v);
+		}
+
+		uint64_t v;
+		if (!ScanUnsigned(p, p + val.size(), v) || v > uint64_t(std::numeric_limits<T>::max()))
+			notValid<T>(val);
+		return static_cast<T>(v);
+	}
 };
 
 template <>
-std::string Convert::string_to_T(std::string const &val)
+inline std::string Convert::string_to_T(std::string const &val)
 {
         return val;
 };
 
+template <>
+inline double Convert::string_to_T(std::string const &val)
+{
+	const char *p = val.data();
+	double v;
+	if (!ScanDouble(p, p + val.size(), v))
+		notValid<double>(val);
+
+	return v;
+};
+
+template <>
+inline int Convert::string_to_T(std::string const &val)
+{
+	return scanInteger<int>(val);
+};
+
+template <>
+inline long Convert::string_to_T(std::string const &val)
+{
+	return scanInteger<long>(val);
+};
+
+template <>
+inline unsigned Convert::string_to_T(std::string const &val)
+{
+	return scanInteger<unsigned>(val);
+};
+
+template <>
+inline unsigned long Convert::string_to_T(std::string const &val)
+{
+	return scanInteger<unsigned long>(val);
+};
+
 
 /// Class to read configuration files with structure:
 /// name = value # comment
 ///
 class ConfigFile
 {
-friend class SnimModel;
-
 private:
 
 	std::map<std::string, std::string> contents;
 	std::string fName;
 
-	void removeComment(std::string &line) const
+	static bool isBlank(char c)
 	{
-		if (line.find('#') != line.npos)
-			line.erase(line.find('#'));
+		return c == ' ' || c == '\t';
 	}
 
-	bool onlyWhitespace(const std::string &line) const
-	{
-		return (line.find_first_not_of(' ') == line.npos);
-	}
-	bool validLine(const std::string &line) const
+	/// Checks the line and adds its key and value, the line has no comment
+	void parseLine(const char *begin, const char *end, size_t const lineNo)
 	{
-		std::string temp = line;
-		temp.erase(0, temp.find_first_not_of("\t "));
-		if (temp[0] == '=')
-			return false;
-
-		for (size_t i = temp.find('=') + 1; i < temp.length(); i++)
-			if (temp[i] != ' ')
-				return true;
-
-		return false;
-	}
-
-	void extractKey(std::string &key, size_t const &sepPos, const std::string &line) const
-	{
-		key = line.substr(0, sepPos);
-		if (key.find('\t') != line.npos || key.find(' ') != line.npos)
-			key.erase(key.find_first_of("\t "));
-	}
-	void extractValue(std::string &value, size_t const &sepPos, const std::string &line) const
-	{
-		value = line.substr(sepPos + 1);
-		value.erase(0, value.find_first_not_of("\t "));
-		value.erase(value.find_last_not_of("\t ") + 1);
-	}
-
-	void extractContents(const std::string &line) 
-	{
-		std::string temp = line;
-		temp.erase(0, temp.find_first_not_of("\t "));
-		size_t sepPos = temp.find('=');
-
-		std::string key, value;
-		extractKey(key, sepPos, temp);
-		extractValue(value, sepPos, temp);
-
-		if (!keyExists(key))
-			contents.insert(std::pair<std::string, std::string>(key, value));
+		const char *sep = static_cast<const char*>(std::memchr(begin, '=', end - begin));
+		if (!sep)
+			throwConfigError("CFG: Couldn't find separator on line: " + Convert::T_to_string(lineNo) + " of [" + fName + "]");
+
+		const char *key = begin;
+		while (key < sep && isBlank(*key))
+			++key;
+		const char *value = sep + 1;
+		while (value < end && *value == ' ')
+			++value;
+		if (key == sep || value == end)
+			throwConfigError("CFG: Bad format for line: " + Convert::T_to_string(lineNo) + " of [" + fName + "]");
+
+		const char *keyEnd = key;
+		while (keyEnd < sep && !isBlank(*keyEnd))
+			++keyEnd;
+		while (value < end && isBlank(*value))
+			++value;
+		const char *valueEnd = end;
+		while (valueEnd > value && isBlank(valueEnd[-1]))
+			--valueEnd;
+
+		std::string k(key, keyEnd);
+		if (!keyExists(k))
+			contents.insert(std::pair<std::string, std::string>(k, std::string(value, valueEnd)));
 		else
-			exitWithError("CFG: Can only have unique key names!\n");
-	}
-
-	void parseLine(const std::string &line, size_t const lineNo)
-	{
-		if (line.find('=') == line.npos)
-			exitWithError("CFG: Couldn't find separator on line: " + Convert::T_to_string(lineNo) + "\n");
-
-		if (!validLine(line))
-			exitWithError("CFG: Bad format for line: " + Convert::T_to_string(lineNo) + "\n");
-
-		extractContents(line);
+			throwConfigError("CFG: Can only have unique key names, [" + k + "] is repeated in [" + fName + "]");
 	}
 
+	/// The file is scanned in place, only keys and values are copied
 	void ExtractKeys()
 	{
-		std::ifstream file;
-		file.open(fName.c_str());
-		if (!file)
-			exitWithError("CFG: File " + fName + " couldn't be found!\n");
-
-		std::string line;
-		size_t lineNo = 0;
-		while (std::getline(file, line))
-		{
-			lineNo++;
-			std::string temp = line;
-
-			if (temp.empty())
-				continue;
+		std::unique_ptr<MappedFile> file;
+		try {
+			file.reset(new MappedFile(fName));
+		}
+		catch (const std::runtime_error &) {
+			throwConfigError("CFG: File [" + fName + "] couldn't be found");
+		}
 
-			removeComment(temp);
-			if (onlyWhitespace(temp))
+		LineScanner lines(file->data(), file->size());
+		const char *begin, *end;
+		while (lines.Next(begin, end))
+		{
+			if (OnlyBlanks(begin, end))
 				continue;
 
-			parseLine(temp, lineNo);
+			parseLine(begin, end, lines.LineNo());
 		}
-
-		file.close();
 	}
 public:
     	ConfigFile(){};
@@ -196,6 +229,15 @@ public:
 		return contents.find(key) != contents.end();
 	}
 
+	/// Names of all the keys in the file, in alphabetical order
+	std::vector<std::string> getKeys() const
+	{
+		std::vector<std::string> keys;
+		for (auto const &kv : contents)
+			keys.push_back(kv.first);
+		return keys;
+	}
+
 	template <typename ValueType>
 	ValueType getValueOfKey(const std::string &key, ValueType const &defaultValue = ValueType()) const
 	{
@@ -231,4 +273,4 @@ int main()
 
 }   // End namespace
 
-#endif
\ No newline at end of file
+#endif
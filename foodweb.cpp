@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "snim.h"
+#include "configfile.h"
+
+namespace snim {
+
+NetworkParameters::NetworkParameters(const std::string &fName){
+    ConfigFile cfg(fName);
+    type            = cfg.getValueOfKey<std::string>("network", "");
+    nSpecies        = cfg.getValueOfKey<size_t>("networkSpecies", 0);
+    communitySize   = cfg.getValueOfKey<size_t>("networkSize", 0);
+    connectance     = cfg.getValueOfKey<double>("connectance", 0.1);
+    seed            = cfg.getValueOfKey<size_t>("networkSeed", 0);
+    predationRate   = cfg.getValueOfKey<double>("predationRate", 1.0);
+    growthRate      = cfg.getValueOfKey<double>("growthRate", 1.0);
+    basalFraction   = cfg.getValueOfKey<double>("basalFraction", 0.2);
+    competition     = cfg.getValueOfKey<double>("competition", 0.2);
+    competitionRate = cfg.getValueOfKey<double>("competitionRate", 0.5);
+    immigrationRate = cfg.getValueOfKey<double>("immigrationRate", 0.01);
+    extinctionRate  = cfg.getValueOfKey<double>("extinctionRate", 0.1);
+}
+
+void SnimModel::GenerateNetwork(const NetworkParameters &np){
+    using namespace std;
+
+    if (np.type != "niche" && np.type != "cascade" && np.type != "random" && np.type != "mixed")
+        throw std::invalid_argument("Unknown network type [" + np.type + "], use niche, cascade, random or mixed");
+    if (np.nSpecies < 2 || np.communitySize == 0)
+        throw std::invalid_argument("The network needs networkSpecies > 1 and networkSize > 0");
+    if (np.connectance <= 0 || np.connectance > (np.type == "niche" ? 0.5 : 1.0))
+        throw std::invalid_argument("connectance out of range, it must be in (0, 0.5] for the niche model and (0, 1] for the rest");
+
+    size_t seed = np.seed;
+    if (seed == 0) {
+        std::random_device rd{};
+        seed = rd();
+    }
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> unif(0.0, 1.0);
+    auto chance = [&](double p){ return unif(rng) < p; };
+    auto coefficient = [&](double rate){ return float(rate * (1.0 - unif(rng))); };   // (0, rate]
+
+    size_t S = np.nSpecies;
+    vector<SparseMatrix::Triplet> elems;
+    vector<char> eats(S+1, 0);          // Species with at least one prey
+    auto link = [&](size_t pred, size_t prey, double rate){
+        elems.push_back({uint32_t(pred), uint32_t(prey), coefficient(rate)});
+        eats[pred] = 1;
+    };
+
+    if (np.type == "niche") {
+        // Niche values in increasing order, so species are ranked; each
+        // species eats the ones inside a range of the niche axis below its
+        // own value, of width n * Beta(1, b) with mean 2 * connectance
+        vector<double> n(S+1, 0.0);
+        for (size_t i = 1; i <= S; ++i)
+            n[i] = unif(rng);
+        sort(n.begin()+1, n.end());
+        double b = 1.0 / (2.0 * np.connectance) - 1.0;
+        for (size_t i = 1; i <= S; ++i) {
+            double r = i == 1 ? 0.0 : n[i] * (1.0 - pow(1.0 - unif(rng), 1.0 / b));
+            double c = r / 2 + unif(rng) * (n[i] - r / 2);
+            for (size_t j = 1; j <= S; ++j)
+                if (j != i && n[j] >= c - r / 2 && n[j] <= c + r / 2)
+                    link(i, j, np.predationRate);
+        }
+    }
+    else if (np.type == "cascade" || np.type == "mixed") {
+        // Each species eats the ones of lower rank with the probability that
+        // gives the expected connectance
+        double p = min(1.0, 2.0 * np.connectance * S / (S - 1));
+        for (size_t i = 2; i <= S; ++i)
+            for (size_t j = 1; j < i; ++j)
+                if (chance(p))
+                    link(i, j, np.predationRate);
+    }
+    else {
+        // Almost every species would have a prey and nothing would grow on
+        // the empty space, so the first ones are kept basal and the rest eat
+        // any other species with the probability that gives the connectance
+        size_t nBasal = max<size_t>(1, size_t(np.basalFraction * S + 0.5));
+        if (nBasal >= S)
+            throw std::invalid_argument("basalFraction leaves no consumers in the random network");
+        double p = min(1.0, np.connectance * S * S / (double(S - nBasal) * (S - 1)));
+        for (size_t i = nBasal+1; i <= S; ++i)
+            for (size_t j = 1; j <= S; ++j)
+                if (j != i && chance(p))
+                    link(i, j, np.predationRate);
+    }
+
+    // Basal species grow on the empty space, with mixed they also compete
+    // for it: one of each competing pair, at random, displaces the other
+    for (size_t i = 1; i <= S; ++i)
+        if (!eats[i])
+            elems.push_back({uint32_t(i), 0, coefficient(np.growthRate)});
+
+    if (np.type == "mixed")
+        for (size_t i = 1; i <= S; ++i)
+            for (size_t j = i+1; j <= S; ++j)
+                if (!eats[i] && !eats[j] && chance(np.competition)) {
+                    bool iWins = chance(0.5);
+                    elems.push_back({uint32_t(iWins ? i : j), uint32_t(iWins ? j : i),
+                                     coefficient(np.competitionRate)});
+                }
+
+    nSpecies = S;
+    communitySize = np.communitySize;
+    u.assign(S, float(np.immigrationRate));
+    e.assign(S, float(np.extinctionRate));
+    names.clear();
+    edgeList = false;
+    compiled.reset();
+    omega = SparseMatrix::FromTriplets(S+1, elems);
+}
+
+} // end namespace
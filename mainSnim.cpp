@@ -1,12 +1,29 @@
-// 
+//
 // Sochastic Network Interaction Model
 //
 #include "snim.h"
+#include "sweep.h"
+#include "abc.h"
+#include "sensitivity.h"
+#include "trajfile.h"
+#include "stats.h"
+#include "batch.h"
 
 static void show_usage(std::string name)
 {
-    std::cerr << "\nSNIM Stochactic Network Interaction Model\n\n " 
+    std::cerr << "\nSNIM Stochactic Network Interaction Model\n\n "
               << "Usage: " << name << " SimulationParameterFile ModelParameterFile [OutputFileName]\n"
+              << "        " << name << " --sweep SweepSpecificationFile\n"
+              << "        " << name << " --abc AbcParameterFile\n"
+              << "        " << name << " --gsa SensitivityParameterFile\n"
+              << "        " << name << " --export BinaryTrajectoryFile OutputFileName\n"
+              << "        " << name << " --convert ModelParameterFile BinaryModelFile\n"
+              << "        " << name << " --manifest ManifestFile [Threads]\n"
+              << "        " << name << " --resume CheckpointFile SimulationParameterFile ModelParameterFile OutputFileName\n\n"
+              << "Options: --set key=value  changes a parameter after reading the files, keys: omega[i,j], e[i], u[i],\n"
+              << "                          omegaScale, communitySize, tau, nEvals and iniCond\n\n"
+              << "If the simulation file has a network key the model is a generated food web and the\n"
+              << "ModelParameterFile is not read, it can be given as -\n"
               << std::endl;
 }
 
@@ -15,31 +32,190 @@ int main(int argc, char* argv[]){
     using namespace std;
     using namespace snim;
 
+    // --set key=value options can be anywhere, they change the model or the
+    // simulation parameters after the files are read
+    //
+    SweepSpec overrides;
+    vector<string> setArgs;
+    vector<char*> args;
+    for (int i = 0; i < argc; ++i) {
+        if (string(argv[i]) == "--set" && i + 1 < argc) {
+            setArgs.push_back(argv[++i]);
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    argc = args.size();
+    argv = args.data();
+    try {
+        for (auto const &ov : setArgs)
+            overrides.AddOverride(ov);
+    }
+    catch (const std::exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (argc >= 2 && (string(argv[1]) == "--sweep" || string(argv[1]) == "--abc" ||
+                      string(argv[1]) == "--gsa")) {
+        if (argc < 3) {
+            show_usage(argv[0]);
+            return 1;
+        }
+        try {
+            // Overrides are axes of one level of the sweep, applied after
+            // the ones of the file
+            if (string(argv[1]) == "--sweep") {
+                SweepSpec spec(argv[2]);
+                for (auto const &ov : setArgs)
+                    spec.AddOverride(ov);
+                RunSweep(spec);
+            }
+            else if (string(argv[1]) == "--abc")
+                RunAbc(argv[2], overrides);
+            else
+                RunGsa(argv[2], overrides);
+        }
+        catch (const std::exception &e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "--export") {
+        if (argc < 4) {
+            show_usage(argv[0]);
+            return 1;
+        }
+        try {
+            TrajectoryFile in(argv[2]);
+            ofstream fout(argv[3]);
+            if (!fout)
+                throw std::runtime_error(string("Can't open output file ") + argv[3]);
+            in.WriteTsv(fout);
+            fout.flush();
+            if (!fout)
+                throw std::runtime_error(string("Error writing output file ") + argv[3]);
+        }
+        catch (const std::exception &e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "--convert") {
+        if (argc < 4) {
+            show_usage(argv[0]);
+            return 1;
+        }
+        try {
+            SnimModel mdl;
+            mdl.ReadModelParams(argv[2]);
+            mdl.WriteBinaryModel(argv[3]);
+        }
+        catch (const std::exception &e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "--manifest") {
+        if (argc < 3) {
+            show_usage(argv[0]);
+            return 1;
+        }
+        try {
+            auto jobs = ReadManifest(argv[2]);
+            for (auto &job : jobs)
+                job.overrides.insert(job.overrides.end(), setArgs.begin(), setArgs.end());
+            auto status = RunBatch(jobs, argc > 3 ? strtoul(argv[3], nullptr, 10) : 0);
+            WriteBatchStatus(string(argv[2]) + ".status", jobs, status);
+
+            size_t failed = 0;
+            for (size_t j = 0; j < jobs.size(); ++j)
+                if (!status[j].ok) {
+                    ++failed;
+                    cerr << "Line " << jobs[j].line << ": " << status[j].message << endl;
+                }
+            cout << jobs.size() << " jobs, " << jobs.size() - failed << " ok, " << failed << " failed, status in "
+                 << argv[2] << ".status" << endl;
+            return failed ? 1 : 0;
+        }
+        catch (const std::exception &e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
+    // Continue a simulation from a checkpoint, the rest of the arguments are
+    // the ones of the interrupted run
+    //
+    std::unique_ptr<Checkpoint> from;
+    if (argc >= 2 && string(argv[1]) == "--resume") {
+        if (argc < 6) {
+            show_usage(argv[0]);
+            return 1;
+        }
+        try {
+            from.reset(new Checkpoint());
+            from->Load(argv[2]);
+        }
+        catch (const std::exception &e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc < 3) {
         show_usage(argv[0]);
         return 1;
     }
-    
-    SnimModel mdl;
-    mdl.ReadModelParams(argv[2]);
 
     // Read simulation parameters from file
     //
-    SimulationParameters sp(argv[1]);
+    SimulationParameters sp;
+    SnimModel mdl;
+    try {
+        sp = SimulationParameters(argv[1]);
+        NetworkParameters np(argv[1]);
+        if (np.Active())
+            mdl.GenerateNetwork(np);
+        else if (sp.modelCache)
+            mdl.ReadModelParamsCached(argv[2], string(argv[2]) + ".snc");
+        else
+            mdl.ReadModelParams(argv[2]);
+        overrides.ApplyJob(0, mdl, sp);
+    }
+    catch (const std::exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
 
-  
-    matrix <size_t> out;
-    mdl.SimulTauLeap(sp,out);
+    try {
+        if( argc<4) {
+            matrix <size_t> out;
+            mdl.SimulTauLeap(sp,out);
 
-    if( argc<3) {
-        cout << mdl << endl;
-        cout << sp << endl;
-        cout << out << endl;
+            cout << mdl << endl;
+            cout << sp << endl;
+            cout << out << endl;
+        }
+        else {
+            // The output is formatted and written in another thread
+            AsyncSink out(MakeOutputSink(mdl, sp, argv[3], from != nullptr));
+            mdl.SimulTauLeap(sp,out,from.get());
+        }
     }
-    else {
-        ofstream fout(argv[3]);
-        fout << out; 
+    catch (const std::exception &e) {
+        cerr << e.what() << endl;
+        return 1;
     }
-    
+
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   mappedfile.h
+  \brief  Read only view of a whole file, memory mapped when possible
+ */
+#ifndef SNIM_MAPPEDFILE_HH_
+#define SNIM_MAPPEDFILE_HH_
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SNIM_HAVE_MMAP 1
+#endif
+
+namespace snim {
+
+/**
+  \brief The contents of a file as a contiguous block of bytes.
+
+  On POSIX systems the file is memory mapped so nothing is copied, elsewhere
+  it is read in one call into a buffer.
+ */
+class MappedFile {
+    const char *ptr=nullptr;
+    size_t len=0;
+    bool mapped=false;
+    std::vector<char> buffer;
+
+public:
+    explicit MappedFile(const std::string &fName) {
+#ifdef SNIM_HAVE_MMAP
+        int fd = ::open(fName.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("File [" + fName + "] couldn't be opened");
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("File [" + fName + "] couldn't be read");
+        }
+        len = static_cast<size_t>(st.st_size);
+        if (len > 0) {
+            void *p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ptr = static_cast<const char*>(p);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+        if (mapped || len == 0)
+            return;
+#endif
+        std::ifstream is(fName, std::ios::binary | std::ios::ate);
+        if (!is)
+            throw std::runtime_error("File [" + fName + "] couldn't be opened");
+        len = static_cast<size_t>(is.tellg());
+        buffer.resize(len);
+        is.seekg(0);
+        is.read(buffer.data(), len);
+        ptr = buffer.data();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef SNIM_HAVE_MMAP
+        if (mapped)
+            ::munmap(const_cast<char*>(ptr), len);
+#endif
+    }
+
+    const char *data() const { return ptr; }
+
+    size_t size() const { return len; }
+};
+
+} /* end namespace */
+
+#endif
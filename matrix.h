@@ -11,44 +11,115 @@
 #include <random>
 #include <initializer_list>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 namespace snim {
 
+/**
+  \brief Storage of the elements with malloc, the columns are contiguous.
+ */
+struct PackedStorage {
+  static constexpr size_t alignment = alignof(std::max_align_t);
+
+  static size_t leading_dim(size_t rows, size_t elem_size) { (void)elem_size; return rows; }
+  static void* allocate(size_t bytes) { return std::malloc(bytes); }
+  static void release(void* p) { std::free(p); }
+};
+
+/**
+  \brief Storage aligned to a cache line, with each column padded to a whole
+         number of 64 byte lines.
+
+  Every column starts aligned, so it can be read with full width vector loads
+  (64 bytes is the width of AVX-512) without a scalar prologue. The padding
+  of the columns is kept at zero, sums can include it.
+ */
+struct AlignedStorage {
+  static constexpr size_t alignment = 64;
+
+  static size_t leading_dim(size_t rows, size_t elem_size) {
+    if (elem_size == 0 || alignment % elem_size != 0)
+      return rows;
+    size_t per_line = alignment / elem_size;
+    return (rows + per_line - 1) / per_line * per_line;
+  }
+
+  /// The pointer to the block of malloc is kept just before the aligned one
+  ///
+  static void* allocate(size_t bytes) {
+    void* raw = std::malloc(bytes + alignment);
+    if (!raw)
+      return nullptr;
+    auto p = (reinterpret_cast<std::uintptr_t>(raw) + alignment) & ~std::uintptr_t(alignment - 1);
+    reinterpret_cast<void**>(p)[-1] = raw;
+    return reinterpret_cast<void*>(p);
+  }
+
+  static void release(void* p) {
+    if (p)
+      std::free(static_cast<void**>(p)[-1]);
+  }
+};
+
 /**
   \brief A simple column-major matrix of numeric types.
+
+  Column c starts at data() + c * ld(). With the default PackedStorage ld()
+  is rows() and the elements are one contiguous array; AlignedStorage pads
+  the columns so each one starts at a multiple of 64 bytes.
  */
-template<typename T >
+template<typename T, typename Storage = PackedStorage>
 class matrix {
   T* m_elems;
   size_t m_rows;
   size_t m_cols;
+  size_t m_ld;
   
   void check(size_t r, size_t c) const { assert(r < m_rows && c <= m_cols); };
 
+  /// Allocate the elements of a 'rows' by 'cols' matrix with the padding at zero
+  ///
+  static T* allocate(size_t rows, size_t cols, size_t ld) {
+    T* p = (T*)Storage::allocate(ld * cols * sizeof(T));
+    if (ld != rows)
+      for (auto c = 0u; c < cols; ++c)
+        for (auto r = rows; r < ld; ++r)
+          p[r + c * ld] = T(0);
+    return p;
+  }
+
+  /// Element idx of the column-major order without padding
+  ///
+  auto elem(size_t idx) const -> T& {
+    return m_ld == m_rows ? m_elems[idx] : m_elems[idx % m_rows + idx / m_rows * m_ld];
+  }
 
  public:
-  matrix() : m_elems(nullptr), m_rows(0),m_cols(0) {}
+  matrix() : m_elems(nullptr), m_rows(0),m_cols(0), m_ld(0) {}
   /**
     \brief Allocated memory for a 'rows' by 'cols' matrix.
    */
   matrix(size_t rows, size_t cols)
-    : m_elems((T*)std::malloc(rows * cols * sizeof(T))), m_rows(rows), m_cols(cols) {
+    : m_rows(rows), m_cols(cols), m_ld(Storage::leading_dim(rows, sizeof(T))) {
+    m_elems = allocate(m_rows, m_cols, m_ld);
   }
 
   /**
-    \brief Builds a matrix from an existing array (copies the pointer, not the array).
+    \brief Builds a matrix from an existing array (copies the pointer, not the
+           array), that must be allocated by the storage with ld() elements
+           for each column.
    */
   matrix(size_t rows, size_t cols, T* elems)
-    : m_elems(elems), m_rows(rows), m_cols(cols) {
+    : m_elems(elems), m_rows(rows), m_cols(cols), m_ld(Storage::leading_dim(rows, sizeof(T))) {
   }
 
   /**
     \brief Builds a 'rows' by 'cols' matrix filled with 'val'.
    */
-  matrix(size_t rows, size_t cols, T val)
-    : m_elems((T*)std::malloc(rows * cols * sizeof(T))), m_rows(rows), m_cols(cols) {
+  matrix(size_t rows, size_t cols, T val) : matrix(rows, cols) {
     for (auto i = 0u; i < rows * cols; ++i)
-      m_elems[i] = val;
+      elem(i) = val;
   }
 
   /**
@@ -56,46 +127,45 @@ class matrix {
            min and max.
    */
   matrix(size_t rows, size_t cols, size_t seed, T min, T max)  // Disable for integers with enable_if.
-    : m_elems((T*)std::malloc(rows * cols * sizeof(T))), m_rows(rows), m_cols(cols) {
+    : matrix(rows, cols) {
     auto rng = std::mt19937_64(seed);
     auto d = std::uniform_real_distribution<T>(min, max);
     for (auto i = 0u; i < (m_rows * m_cols); ++i)
-      m_elems[i] = d(rng);
+      elem(i) = d(rng);
   }
 
   matrix(size_t rows, size_t cols, std::initializer_list<T> const& xs)
-    : m_elems((T*)std::malloc(rows * cols * sizeof(T))), m_rows(rows), m_cols(cols) {
-    T* es = m_elems;
-    for (auto x : xs) {
-      *es = x;
-      ++es;
-    }
+    : matrix(rows, cols) {
+    auto i = 0u;
+    for (auto x : xs)
+      elem(i++) = x;
   }
 
   ~matrix() {
     if (m_elems)
-      std::free(m_elems);
+      Storage::release(m_elems);
   }
 
-  matrix(matrix const& other) : m_rows(other.m_rows), m_cols(other.m_cols) {
-    size_t const bytes = m_rows * m_cols * sizeof(T);
-    m_elems = (T*)std::malloc(bytes);
+  matrix(matrix const& other) : m_rows(other.m_rows), m_cols(other.m_cols), m_ld(other.m_ld) {
+    size_t const bytes = m_ld * m_cols * sizeof(T);
+    m_elems = (T*)Storage::allocate(bytes);
     std::memcpy(m_elems, other.m_elems, bytes);
   }
 
   auto operator=(matrix const& other) -> matrix& {
     m_rows = other.m_rows;
     m_cols = other.m_cols;
-    size_t const bytes = m_rows * m_cols * sizeof(T);
-    T* tmp_elems = (T*)std::malloc(bytes);
+    m_ld = other.m_ld;
+    size_t const bytes = m_ld * m_cols * sizeof(T);
+    T* tmp_elems = (T*)Storage::allocate(bytes);
     std::memcpy(tmp_elems, other.m_elems, bytes);
     if (m_elems)
-      std::free(m_elems);
+      Storage::release(m_elems);
     m_elems = tmp_elems;
     return *this;
   }
 
-  matrix(matrix&& other) : m_elems(other.m_elems), m_rows(other.m_rows), m_cols(other.m_cols) {
+  matrix(matrix&& other) : m_elems(other.m_elems), m_rows(other.m_rows), m_cols(other.m_cols), m_ld(other.m_ld) {
     other.m_elems = nullptr;
   }
 
@@ -103,9 +173,10 @@ class matrix {
     if (this != &other) {
       m_rows = other.m_rows;
       m_cols = other.m_cols;
+      m_ld = other.m_ld;
 
       if (m_elems)
-        std::free(m_elems);
+        Storage::release(m_elems);
       m_elems = other.m_elems;
       other.m_elems = nullptr;
     }
@@ -114,11 +185,9 @@ class matrix {
 
   auto operator=(std::initializer_list<T> const& xs) -> matrix& {
     assert(size() == xs.size());
-    T* es = m_elems;
-    for (auto x : xs) {
-      *es = x;
-      ++es;
-    }
+    auto i = 0u;
+    for (auto x : xs)
+      elem(i++) = x;
 
     return *this;
   }
@@ -126,10 +195,10 @@ class matrix {
   void resize(size_t rows, size_t cols) {
     m_rows = rows;
     m_cols = cols;
+    m_ld = Storage::leading_dim(rows, sizeof(T));
     if (m_elems)
-      std::free(m_elems);
-    size_t const bytes = m_rows * m_cols * sizeof(T);
-    m_elems = (T*)std::malloc(bytes);
+      Storage::release(m_elems);
+    m_elems = allocate(m_rows, m_cols, m_ld);
   
   }
 
@@ -140,6 +209,30 @@ class matrix {
     return m_elems;
   }
 
+  /**
+    \brief Distance in elements between the starts of two columns, rows()
+           plus the padding of the storage.
+   */
+  auto ld() const -> size_t {
+    return m_ld;
+  }
+
+  /**
+    \brief Pointer to the first element of a column, aligned to
+           Storage::alignment with AlignedStorage.
+   */
+  auto col_data(size_t col) const -> T* {
+    assert(col < m_cols);
+    return m_elems + col * m_ld;
+  }
+
+  /**
+    \brief Number of elements allocated, including the padding.
+   */
+  auto padded_size() const -> size_t {
+    return m_ld * m_cols;
+  }
+
   /**
     \brief Total number of elements in the matrix.
    */
@@ -158,7 +251,7 @@ class matrix {
     \brief Number of bytes allocated on the free store for the elements.
    */
   auto bytes() const -> size_t {
-    return size() * sizeof(T);
+    return padded_size() * sizeof(T);
   }
 
   /**
@@ -216,7 +309,7 @@ class matrix {
    */
   auto col_cpy(size_t col, T* c) const -> void {
     assert(col < m_cols);
-    std::memcpy(c, m_elems + col * m_rows, m_rows * sizeof(T));
+    std::memcpy(c, m_elems + col * m_ld, m_rows * sizeof(T));
   }
 
   /**
@@ -233,7 +326,8 @@ class matrix {
   ///
   auto column(size_t col) const -> matrix {
     assert(col < m_cols);
-    matrix<T> c(m_rows,1, col_cpy(col));
+    matrix c(m_rows,1);
+    col_cpy(col, c.m_elems);
     return c;
   }
 
@@ -245,7 +339,7 @@ class matrix {
   auto row_cpy(size_t row, T* r) const -> void {
     assert(row < m_rows);
     for (auto i = 0u; i < m_cols; ++i)
-      r[i] = m_elems[i * m_rows + row];
+      r[i] = m_elems[i * m_ld + row];
   }
 
   /**
@@ -265,7 +359,7 @@ class matrix {
     assert(row < m_rows);
     T s=0;
     for (auto i = 0u; i < m_cols; ++i)
-       s += m_elems[i * m_rows + row];
+       s += m_elems[i * m_ld + row];
     return s;
   }
   
@@ -278,7 +372,7 @@ class matrix {
     to++;
     T s=0;
     for (auto i = from; i < to; ++i)
-       s += m_elems[i * m_rows + row];
+       s += m_elems[i * m_ld + row];
 
     return static_cast<double>(s/(to-from));
   }
@@ -291,23 +385,25 @@ class matrix {
 
     T s=0;
     for (auto i = 0u; i < m_rows; ++i)
-      s += m_elems[col * m_rows + i];
+      s += m_elems[col * m_ld + i];
     return s;
   }
 
    /**
-    \brief Get element using the index of the flat column-major internal array.
+    \brief Get element using the index of the flat column-major internal
+           array, that includes the padding of the storage.
    */
   auto operator[](size_t idx) const -> T& {
-    assert(idx < m_rows*m_cols);
+    assert(idx < m_ld*m_cols);
     return m_elems[idx];
   }
 
   /**
-    \brief Get element using the index of the flat column-major internal array.
+    \brief Get element using the index of the flat column-major internal
+           array, that includes the padding of the storage.
    */
   auto operator()(size_t idx) const -> T& {
-    assert(idx < m_rows*m_cols);
+    assert(idx < m_ld*m_cols);
     return m_elems[idx];
   }
 
@@ -316,69 +412,69 @@ class matrix {
    */
   auto operator()(size_t row, size_t col) const -> T& {
     check(row,col);
-    return m_elems[row + col * m_rows];
+    return m_elems[row + col * m_ld];
   }
 
-  template<typename T_>
-  friend auto operator<(matrix<T_> const&, matrix<T_> const&) -> bool;
+  template<typename T_, typename S_>
+  friend auto operator<(matrix<T_,S_> const&, matrix<T_,S_> const&) -> bool;
 
-  template<typename T_>
-  friend auto operator==(matrix<T_> const&, matrix<T_> const&) -> bool;
+  template<typename T_, typename S_>
+  friend auto operator==(matrix<T_,S_> const&, matrix<T_,S_> const&) -> bool;
 
-  template<typename T_>
-  friend auto operator!=(matrix<T_> const&, matrix<T_> const&) -> bool;
+  template<typename T_, typename S_>
+  friend auto operator!=(matrix<T_,S_> const&, matrix<T_,S_> const&) -> bool;
 
-  template<typename T_>
-  friend auto operator<<(std::ostream&, matrix<T_> const&) -> std::ostream&;
+  template<typename T_, typename S_>
+  friend auto operator<<(std::ostream&, matrix<T_,S_> const&) -> std::ostream&;
 
-  template<typename T_>
-  friend auto operator<<(std::ofstream&, matrix<T_> const&) -> std::ofstream&;
+  template<typename T_, typename S_>
+  friend auto operator<<(std::ofstream&, matrix<T_,S_> const&) -> std::ofstream&;
 
-  template<typename T_>
-  friend void col_cpy(size_t col, matrix<T_> const&, matrix<T_> & );
+  template<typename T_, typename S_>
+  friend void col_cpy(size_t col, matrix<T_,S_> const&, matrix<T_,S_> & );
 
 };
 
-template<typename T>
-void col_cpy( size_t col, matrix<T> const& D, matrix<T> & A ) {
+template<typename T, typename S>
+void col_cpy( size_t col, matrix<T,S> const& D, matrix<T,S> & A ) {
     if(A.cols()>1)
        A(D.m_rows,1);
     D.col_cpy(col,A.m_elems);
             
 }
 
-template<typename T>
-auto operator<(matrix<T> const& lhs, matrix<T> const& rhs) -> bool {
+template<typename T, typename S>
+auto operator<(matrix<T,S> const& lhs, matrix<T,S> const& rhs) -> bool {
   bool const size_cmp = lhs.size() != rhs.size();
   if (!size_cmp)
     return size_cmp;
   for (auto i = 0u; i < lhs.size(); ++i) {
-    if (lhs[i] != rhs[i]) {
-      return lhs[i] < rhs[i];
+    if (lhs.elem(i) != rhs.elem(i)) {
+      return lhs.elem(i) < rhs.elem(i);
     }
   }
   return true;
 }
 
-template<typename T>
-auto operator==(matrix<T> const& lhs, matrix<T> const& rhs) -> bool {
+template<typename T, typename S>
+auto operator==(matrix<T,S> const& lhs, matrix<T,S> const& rhs) -> bool {
   if (lhs.size() != rhs.size())
     return false;
   for (auto i = 0u; i < lhs.size(); ++i) {
-    if (lhs[i] != rhs[i]) {
+    if (lhs.elem(i) != rhs.elem(i)) {
       return false;
     }
   }
   return true;
 }
 
-template<typename T>
-auto operator!=(matrix<T> const& lhs, matrix<T> const& rhs) -> bool {
+template<typename T, typename S>
+auto operator!=(matrix<T,S> const& lhs, matrix<T,S> const& rhs) -> bool {
   return !(lhs == rhs);
 }
 
-template<typename T>
-auto operator<<(std::ostream& os, matrix<T> const& m) -> std::ostream& {
+template<typename T, typename S>
+auto operator<<(std::ostream& os, matrix<T,S> const& m) -> std::ostream& {
   for (auto r = 0u; r < m.m_rows; ++r) {
     os << '[' << m(r, 0);
     for (auto c = 1u; c < m.m_cols; ++c) {
@@ -389,8 +485,8 @@ auto operator<<(std::ostream& os, matrix<T> const& m) -> std::ostream& {
   return os;
 }
 
-template<typename T>
-auto operator<<(std::ofstream& os, matrix<T> const& m) -> std::ofstream& {
+template<typename T, typename S>
+auto operator<<(std::ofstream& os, matrix<T,S> const& m) -> std::ofstream& {
   for (auto r = 0u; r < m.m_rows; ++r) {
     os << m(r, 0);
     for (auto c = 1u; c < m.m_cols; ++c) {
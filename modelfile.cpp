@@ -0,0 +1,237 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include "snim.h"
+#include "mappedfile.h"
+
+namespace snim {
+
+// Binary model file: a header and 8 byte aligned sections with the
+// immigration and extinction vectors, the arrays of the sparse interaction
+// matrix and the species names separated by new lines. Version 2 adds the
+// arrays of the compiled model.
+//
+static const char modelMagic[8] = {'S','N','I','M','M','D','L','\0'};
+static const uint32_t modelVersion = 2;
+static const uint32_t modelEndianTag = 0x01020304;
+
+struct ModelFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianTag;
+    uint64_t nSpecies;
+    uint64_t communitySize;
+    uint64_t nonZeros;                  // Elements of omega stored
+    uint64_t namesBytes;
+    uint64_t sourceHash;                // ContentHash() of the text file, 0 if unknown
+    uint64_t nChannels;                 // Channels of the compiled model, version 2
+};
+
+static size_t Aligned(size_t bytes) {
+    return (bytes + 7) / 8 * 8;
+}
+
+/// Hash of the bytes of a file, 8 at a time with the FNV-1a multiplier
+///
+static uint64_t ContentHash(const MappedFile &file){
+    uint64_t h = 14695981039346656037ULL ^ file.size();
+    const char *p = file.data();
+    size_t words = file.size() / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t w;
+        std::memcpy(&w, p + 8 * i, 8);
+        h = (h ^ w) * 1099511628211ULL;
+    }
+    for (size_t i = 8 * words; i < file.size(); ++i)
+        h = (h ^ static_cast<unsigned char>(p[i])) * 1099511628211ULL;
+    return h;
+}
+
+bool IsBinaryModel(const std::string &fName){
+    std::ifstream is(fName, std::ios::binary);
+    char magic[8] = {0};
+    is.read(magic, sizeof(magic));
+    return is && std::memcmp(magic, modelMagic, sizeof(magic)) == 0;
+}
+
+void SnimModel::WriteBinaryModel(const std::string &fName, uint64_t sourceHash) const {
+    std::ofstream os(fName, std::ios::binary);
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+
+    std::string namesText;
+    for (auto const &nm : names)
+        namesText += nm + "\n";
+
+    ModelFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, modelMagic, sizeof(modelMagic));
+    h.version = modelVersion;
+    h.endianTag = modelEndianTag;
+    h.nSpecies = nSpecies;
+    h.communitySize = communitySize;
+    h.nonZeros = omega.nonZeros();
+    h.namesBytes = namesText.size();
+    h.sourceHash = sourceHash;
+    auto cm = GetCompiled();
+    h.nChannels = cm->Channels();
+
+    static const char zeros[8] = {0};
+    auto section = [&os](const void *p, size_t bytes){
+        os.write(static_cast<const char*>(p), bytes);
+        os.write(zeros, Aligned(bytes) - bytes);
+    };
+    section(&h, sizeof(h));
+    section(u.data(), u.size() * sizeof(float));
+    section(e.data(), e.size() * sizeof(float));
+    section(omega.RowStarts(), (omega.rows() + 1) * sizeof(uint64_t));
+    section(omega.Cols(), omega.nonZeros() * sizeof(uint32_t));
+    section(omega.Values(), omega.nonZeros() * sizeof(float));
+    section(namesText.data(), namesText.size());
+    section(cm->ChannelArray(), cm->Channels() * sizeof(Channel));
+    section(cm->PredatorStarts(), (nSpecies + 2) * sizeof(uint64_t));
+    section(cm->PreyStarts(), (nSpecies + 2) * sizeof(uint64_t));
+    section(cm->PreyChannels(), cm->Channels() * sizeof(uint32_t));
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Error writing model file " + fName);
+}
+
+/// The file stays mapped while the interaction matrix or the compiled model
+/// use it
+///
+void SnimModel::ReadBinaryModel(const std::string &fName){
+    std::shared_ptr<MappedFile> file(new MappedFile(fName));
+    ReadBinaryModel(fName, file);
+}
+
+void SnimModel::ReadBinaryModel(const std::string &fName, std::shared_ptr<MappedFile> file){
+
+    ModelFileHeader h;
+    if (file->size() < sizeof(h))
+        throw std::runtime_error("File [" + fName + "] is not a model file");
+    std::memcpy(&h, file->data(), sizeof(h));
+    if (std::memcmp(h.magic, modelMagic, sizeof(modelMagic)) != 0)
+        throw std::runtime_error("File [" + fName + "] is not a model file");
+    if (h.endianTag != modelEndianTag)
+        throw std::runtime_error("File [" + fName + "] was written with another byte order");
+    if (h.version > modelVersion)
+        throw std::runtime_error("File [" + fName + "] has an unknown version");
+
+    size_t n = h.nSpecies;
+    size_t pos = sizeof(h);
+    size_t uPos = pos;          pos += Aligned(n * sizeof(float));
+    size_t ePos = pos;          pos += Aligned(n * sizeof(float));
+    size_t rowPos = pos;        pos += Aligned((n + 2) * sizeof(uint64_t));
+    size_t colPos = pos;        pos += Aligned(h.nonZeros * sizeof(uint32_t));
+    size_t valPos = pos;        pos += Aligned(h.nonZeros * sizeof(float));
+    size_t namesPos = pos;      pos += Aligned(h.namesBytes);
+    size_t chPos = pos, predPos = pos, preyPos = pos, preyChPos = pos;
+    if (h.version >= 2) {
+        chPos = pos;            pos += Aligned(h.nChannels * sizeof(Channel));
+        predPos = pos;          pos += Aligned((n + 2) * sizeof(uint64_t));
+        preyPos = pos;          pos += Aligned((n + 2) * sizeof(uint64_t));
+        preyChPos = pos;        pos += Aligned(h.nChannels * sizeof(uint32_t));
+    }
+    if (pos > file->size())
+        throw std::runtime_error("File [" + fName + "] is truncated");
+
+    const char *base = file->data();
+    if (reinterpret_cast<const uint64_t*>(base + rowPos)[n + 1] != h.nonZeros)
+        throw std::runtime_error("File [" + fName + "] has a corrupted interaction matrix");
+    if (h.version >= 2 && reinterpret_cast<const uint64_t*>(base + predPos)[n + 1] != h.nChannels)
+        throw std::runtime_error("File [" + fName + "] has a corrupted compiled model");
+    nSpecies = n;
+    communitySize = h.communitySize;
+    auto uPtr = reinterpret_cast<const float*>(base + uPos);
+    auto ePtr = reinterpret_cast<const float*>(base + ePos);
+    u.assign(uPtr, uPtr + n);
+    e.assign(ePtr, ePtr + n);
+
+    names.clear();
+    std::string namesText(base + namesPos, h.namesBytes);
+    std::istringstream is(namesText);
+    std::string nm;
+    while (std::getline(is, nm))
+        names.push_back(nm);
+
+    omega = SparseMatrix::View(n + 1, h.nonZeros,
+                               reinterpret_cast<const uint64_t*>(base + rowPos),
+                               reinterpret_cast<const uint32_t*>(base + colPos),
+                               reinterpret_cast<const float*>(base + valPos),
+                               file);
+    compiled.reset();
+    if (h.version >= 2)
+        compiled = CompiledModel::View(n + 1, h.nChannels,
+                                       reinterpret_cast<const Channel*>(base + chPos),
+                                       reinterpret_cast<const uint64_t*>(base + predPos),
+                                       reinterpret_cast<const uint64_t*>(base + preyPos),
+                                       reinterpret_cast<const uint32_t*>(base + preyChPos),
+                                       file);
+}
+
+/// The cache is used if it is a binary model file of this version tagged
+/// with the hash of the contents of fName, anything else is rebuilt
+///
+bool SnimModel::ReadModelParamsCached(const std::string &fName, const std::string &cacheName){
+    uint64_t hash;
+    {
+        MappedFile source(fName);
+        hash = ContentHash(source);
+    }
+
+    try {
+        if (IsBinaryModel(cacheName)) {
+            std::shared_ptr<MappedFile> file(new MappedFile(cacheName));
+            ModelFileHeader h;
+            if (file->size() < sizeof(h))
+                throw std::runtime_error("Cache [" + cacheName + "] is truncated");
+            std::memcpy(&h, file->data(), sizeof(h));
+            if (h.version == modelVersion && h.endianTag == modelEndianTag && h.sourceHash == hash) {
+                ReadBinaryModel(cacheName, file);
+                return true;
+            }
+        }
+    }
+    catch (const std::runtime_error &) {
+        // A damaged cache is written again
+    }
+
+    ReadModelParams(fName);
+
+    // Written to a file of its own and renamed, so a run never maps a cache
+    // that another run is writing
+    std::random_device rd{};
+    std::string tmpName = cacheName + "." + std::to_string(rd()) + ".tmp";
+    try {
+        WriteBinaryModel(tmpName, hash);
+    }
+    catch (const std::runtime_error &) {
+        std::remove(tmpName.c_str());   // The cache is optional, e.g. the directory is read only
+        return false;
+    }
+    if (std::rename(tmpName.c_str(), cacheName.c_str()) != 0)
+        std::remove(tmpName.c_str());
+    return false;
+}
+
+} // end namespace
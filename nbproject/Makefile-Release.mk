@@ -35,8 +35,19 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 
 # Object Files
 OBJECTFILES= \
+	${OBJECTDIR}/abc.o \
+	${OBJECTDIR}/batch.o \
+	${OBJECTDIR}/checkpoint.o \
+	${OBJECTDIR}/foodweb.o \
 	${OBJECTDIR}/mainSnim.o \
-	${OBJECTDIR}/snim.o
+	${OBJECTDIR}/modelfile.o \
+	${OBJECTDIR}/sensitivity.o \
+	${OBJECTDIR}/snim.o \
+	${OBJECTDIR}/stats.o \
+	${OBJECTDIR}/sweep.o \
+	${OBJECTDIR}/trajectory.o \
+	${OBJECTDIR}/trajfile.o \
+	${OBJECTDIR}/tsvwriter.o
 
 # Test Directory
 TESTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}/tests
@@ -63,7 +74,7 @@ FFLAGS=
 ASFLAGS=
 
 # Link Libraries and Options
-LDLIBSOPTIONS=
+LDLIBSOPTIONS=-lpthread
 
 # Build Targets
 .build-conf: ${BUILD_SUBPROJECTS}
@@ -73,16 +84,71 @@ ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/snim: ${OBJECTFILES}
 	${MKDIR} -p ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}
 	${LINK.cc} -o ${CND_DISTDIR}/${CND_CONF}/${CND_PLATFORM}/snim ${OBJECTFILES} ${LDLIBSOPTIONS}
 
+${OBJECTDIR}/abc.o: abc.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/abc.o abc.cpp
+
+${OBJECTDIR}/batch.o: batch.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/batch.o batch.cpp
+
+${OBJECTDIR}/checkpoint.o: checkpoint.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/checkpoint.o checkpoint.cpp
+
+${OBJECTDIR}/foodweb.o: foodweb.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/foodweb.o foodweb.cpp
+
 ${OBJECTDIR}/mainSnim.o: mainSnim.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/mainSnim.o mainSnim.cpp
 
+${OBJECTDIR}/modelfile.o: modelfile.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/modelfile.o modelfile.cpp
+
+${OBJECTDIR}/sensitivity.o: sensitivity.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sensitivity.o sensitivity.cpp
+
 ${OBJECTDIR}/snim.o: snim.cpp
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/snim.o snim.cpp
 
+${OBJECTDIR}/stats.o: stats.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/stats.o stats.cpp
+
+${OBJECTDIR}/sweep.o: sweep.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sweep.o sweep.cpp
+
+${OBJECTDIR}/trajectory.o: trajectory.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/trajectory.o trajectory.cpp
+
+${OBJECTDIR}/trajfile.o: trajfile.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/trajfile.o trajfile.cpp
+
+${OBJECTDIR}/tsvwriter.o: tsvwriter.cpp
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/tsvwriter.o tsvwriter.cpp
+
 # Subprojects
 .build-subprojects:
 
@@ -101,6 +167,58 @@ ${TESTDIR}/test/testSnim.o: test/testSnim.cpp
 	$(COMPILE.cc) -O2 -I. -MMD -MP -MF "$@.d" -o ${TESTDIR}/test/testSnim.o test/testSnim.cpp
 
 
+${OBJECTDIR}/abc_nomain.o: ${OBJECTDIR}/abc.o abc.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/abc.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/abc_nomain.o abc.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/abc.o ${OBJECTDIR}/abc_nomain.o;\
+	fi
+
+${OBJECTDIR}/batch_nomain.o: ${OBJECTDIR}/batch.o batch.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/batch.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/batch_nomain.o batch.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/batch.o ${OBJECTDIR}/batch_nomain.o;\
+	fi
+
+${OBJECTDIR}/checkpoint_nomain.o: ${OBJECTDIR}/checkpoint.o checkpoint.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/checkpoint.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/checkpoint_nomain.o checkpoint.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/checkpoint.o ${OBJECTDIR}/checkpoint_nomain.o;\
+	fi
+
+${OBJECTDIR}/foodweb_nomain.o: ${OBJECTDIR}/foodweb.o foodweb.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/foodweb.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/foodweb_nomain.o foodweb.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/foodweb.o ${OBJECTDIR}/foodweb_nomain.o;\
+	fi
+
 ${OBJECTDIR}/mainSnim_nomain.o: ${OBJECTDIR}/mainSnim.o mainSnim.cpp 
 	${MKDIR} -p ${OBJECTDIR}
 	@NMOUTPUT=`${NM} ${OBJECTDIR}/mainSnim.o`; \
@@ -114,6 +232,32 @@ ${OBJECTDIR}/mainSnim_nomain.o: ${OBJECTDIR}/mainSnim.o mainSnim.cpp
 	    ${CP} ${OBJECTDIR}/mainSnim.o ${OBJECTDIR}/mainSnim_nomain.o;\
 	fi
 
+${OBJECTDIR}/modelfile_nomain.o: ${OBJECTDIR}/modelfile.o modelfile.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/modelfile.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/modelfile_nomain.o modelfile.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/modelfile.o ${OBJECTDIR}/modelfile_nomain.o;\
+	fi
+
+${OBJECTDIR}/sensitivity_nomain.o: ${OBJECTDIR}/sensitivity.o sensitivity.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/sensitivity.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sensitivity_nomain.o sensitivity.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/sensitivity.o ${OBJECTDIR}/sensitivity_nomain.o;\
+	fi
+
 ${OBJECTDIR}/snim_nomain.o: ${OBJECTDIR}/snim.o snim.cpp 
 	${MKDIR} -p ${OBJECTDIR}
 	@NMOUTPUT=`${NM} ${OBJECTDIR}/snim.o`; \
@@ -127,6 +271,71 @@ ${OBJECTDIR}/snim_nomain.o: ${OBJECTDIR}/snim.o snim.cpp
 	    ${CP} ${OBJECTDIR}/snim.o ${OBJECTDIR}/snim_nomain.o;\
 	fi
 
+${OBJECTDIR}/stats_nomain.o: ${OBJECTDIR}/stats.o stats.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/stats.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/stats_nomain.o stats.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/stats.o ${OBJECTDIR}/stats_nomain.o;\
+	fi
+
+${OBJECTDIR}/sweep_nomain.o: ${OBJECTDIR}/sweep.o sweep.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/sweep.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/sweep_nomain.o sweep.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/sweep.o ${OBJECTDIR}/sweep_nomain.o;\
+	fi
+
+${OBJECTDIR}/trajectory_nomain.o: ${OBJECTDIR}/trajectory.o trajectory.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/trajectory.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/trajectory_nomain.o trajectory.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/trajectory.o ${OBJECTDIR}/trajectory_nomain.o;\
+	fi
+
+${OBJECTDIR}/trajfile_nomain.o: ${OBJECTDIR}/trajfile.o trajfile.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/trajfile.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/trajfile_nomain.o trajfile.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/trajfile.o ${OBJECTDIR}/trajfile_nomain.o;\
+	fi
+
+${OBJECTDIR}/tsvwriter_nomain.o: ${OBJECTDIR}/tsvwriter.o tsvwriter.cpp 
+	${MKDIR} -p ${OBJECTDIR}
+	@NMOUTPUT=`${NM} ${OBJECTDIR}/tsvwriter.o`; \
+	if (echo "$$NMOUTPUT" | ${GREP} '|main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T main$$') || \
+	   (echo "$$NMOUTPUT" | ${GREP} 'T _main$$'); \
+	then  \
+	    ${RM} "$@.d";\
+	    $(COMPILE.cc) -O2 -Dmain=__nomain -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/tsvwriter_nomain.o tsvwriter.cpp;\
+	else  \
+	    ${CP} ${OBJECTDIR}/tsvwriter.o ${OBJECTDIR}/tsvwriter_nomain.o;\
+	fi
+
 # Run Test Targets
 .test-conf:
 	@if [ "${TEST}" = "" ]; \
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   numa.h
+  \brief  CPU and NUMA node topology, and pinning of threads to CPUs
+ */
+#ifndef SNIM_NUMA_HH_
+#define SNIM_NUMA_HH_
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace snim {
+
+/**
+  \brief CPUs available to the process grouped by NUMA node.
+
+  On Linux the nodes are read from /sys/devices/system/node, on other systems
+  or without that information all the CPUs belong to node 0.
+ */
+struct NumaTopology {
+    std::vector<int> cpus;              /// CPUs in the order workers are pinned
+    std::vector<int> nodeOfCpu;         /// Node of each entry of cpus
+    size_t nNodes=1;
+
+    NumaTopology() {
+        std::vector< std::vector<int> > byNode;
+
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        for (int node = 0; ; ++node) {
+            std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!f)
+                break;
+            std::string list;
+            std::getline(f, list);
+
+            std::vector<int> nodeCpus;
+            for (auto const &r : ParseCpuList(list))
+                if (!haveMask || CPU_ISSET(r, &allowed))
+                    nodeCpus.push_back(r);
+            byNode.push_back(nodeCpus);
+        }
+
+        if (byNode.empty() && haveMask) {
+            std::vector<int> all;
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &allowed))
+                    all.push_back(c);
+            byNode.push_back(all);
+        }
+#endif
+        if (byNode.empty()) {
+            std::vector<int> all;
+            for (int c = 0; c < static_cast<int>(std::thread::hardware_concurrency()); ++c)
+                all.push_back(c);
+            byNode.push_back(all);
+        }
+
+        // Interleave the nodes so a pool smaller than the machine still
+        // spreads over all the sockets
+        //
+        nNodes = byNode.size();
+        for (size_t i = 0; ; ++i) {
+            bool any = false;
+            for (size_t n = 0; n < byNode.size(); ++n)
+                if (i < byNode[n].size()) {
+                    cpus.push_back(byNode[n][i]);
+                    nodeOfCpu.push_back(n);
+                    any = true;
+                }
+            if (!any)
+                break;
+        }
+    }
+
+    /// Parse a Linux cpu list like "0-3,8-11"
+    ///
+    static std::vector<int> ParseCpuList(const std::string &list) {
+        std::vector<int> out;
+        std::istringstream strline(list);
+        std::string range;
+        while (std::getline(strline, range, ',')) {
+            int from=0, to=0;
+            char dash=0;
+            std::istringstream r(range);
+            if (!(r >> from))
+                continue;
+            to = from;
+            if (r >> dash >> to && dash != '-')
+                to = from;
+            for (int c = from; c <= to; ++c)
+                out.push_back(c);
+        }
+        return out;
+    }
+
+    /// Topology of the machine, read from sysfs only the first time
+    ///
+    static const NumaTopology &System() {
+        static const NumaTopology topo;
+        return topo;
+    }
+
+    /// Pin the calling thread to the i-th CPU (modulo the number of CPUs)
+    /// and set cpuNode to the node of that CPU, returns false if the
+    /// system refused the affinity
+    ///
+    bool PinCurrentThread(size_t i, size_t &cpuNode) const {
+        if (cpus.empty())
+            return false;
+        i %= cpus.size();
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[i], &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            return false;
+#endif
+        cpuNode = nodeOfCpu[i];
+        return true;
+    }
+};
+
+} /* end namespace */
+
+#endif
@@ -0,0 +1,348 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include "sensitivity.h"
+#include "abc.h"
+#include "threadpool.h"
+#include "configfile.h"
+
+namespace snim {
+
+void GsaFactor::Apply(SnimModel &mdl, double x) const {
+    float val = min + x * (max - min);
+    switch (kind) {
+        case Omega:
+            mdl.SetOmega(row, col, val);
+            break;
+        case Extinction:
+            mdl.SetExtinction(row, val);
+            break;
+        case Immigration:
+            mdl.SetInmigration(row, val);
+            break;
+    }
+}
+
+/// Read sensitivity analysis parameters, every key that is not a general
+/// option is a factor
+///
+GsaParameters::GsaParameters(const std::string &fName){
+
+    ConfigFile cfg(fName);
+    modelFile = cfg.getValueOfKey<std::string>("model");
+    simFile   = cfg.getValueOfKey<std::string>("simulation");
+    outPrefix = cfg.getValueOfKey<std::string>("output", "gsa");
+    morris    = cfg.getValueOfKey<std::string>("method", "sobol") == "morris";
+    nThreads  = cfg.getValueOfKey<size_t>("threads", 0);
+    pinThreads = cfg.getValueOfKey<int>("pinThreads", 0) != 0;
+    samples   = cfg.getValueOfKey<size_t>("samples", 1000);
+    levels    = cfg.getValueOfKey<size_t>("levels", 4);
+    fromTime  = cfg.getValueOfKey<size_t>("fromTime", 0);
+    rndSeed   = cfg.getValueOfKey<size_t>("rndSeed", 0);
+
+    if (modelFile.empty() || simFile.empty())
+        throw std::invalid_argument("GSA parameters [" + fName + "] need model and simulation files");
+
+    for (auto const &key : cfg.getKeys()) {
+        if (key == "model" || key == "simulation" || key == "output" || key == "method" ||
+            key == "threads" || key == "samples" || key == "levels" || key == "fromTime" ||
+            key == "rndSeed" || key == "pinThreads")
+            continue;
+        AddFactor(key, cfg.getValueOfKey<std::string>(key));
+    }
+    if (factors.empty())
+        throw std::invalid_argument("GSA parameters [" + fName + "] have no factors");
+}
+
+/// \param key omega[i,j], e[i] or u[i]
+/// \param range string with the minimum and maximum
+///
+void GsaParameters::AddFactor(const std::string &key, const std::string &range){
+    GsaFactor f;
+    f.name = key;
+
+    auto bracket = key.find('[');
+    std::string base = key.substr(0, bracket);
+    std::string idx = bracket == key.npos ? "" : key.substr(bracket + 1);
+    std::replace(idx.begin(), idx.end(), ',', ' ');
+    std::istringstream stridx(idx);
+
+    bool ok = false;
+    if (base == "omega") {
+        f.kind = GsaFactor::Omega;
+        ok = static_cast<bool>(stridx >> f.row >> f.col);
+    }
+    else if (base == "e" || base == "u") {
+        f.kind = base == "e" ? GsaFactor::Extinction : GsaFactor::Immigration;
+        ok = static_cast<bool>(stridx >> f.row) && f.row > 0;
+    }
+    else
+        throw std::invalid_argument("GSA: unknown parameter [" + key + "]");
+
+    if (!ok)
+        throw std::invalid_argument("GSA: bad index in [" + key + "]");
+
+    std::istringstream strline(range);
+    if (!(strline >> f.min >> f.max) || !(f.max > f.min))
+        throw std::invalid_argument("GSA: bad range for [" + key + "]");
+
+    factors.push_back(f);
+}
+
+std::vector<GsaIndices> RunGsa(const SnimModel &mdl, const SimulationParameters &sp,
+                               const GsaParameters &gp){
+    using namespace std;
+
+    size_t const k = gp.factors.size();
+    size_t const nSp = mdl.GetNumberOfSpecies();
+    size_t const nOut = 2 + nSp;
+
+    for (auto const &f : gp.factors)
+        if (f.row > nSp || f.col > nSp)
+            throw std::invalid_argument("GSA: species out of range in [" + f.name + "]");
+
+    auto rng = std::mt19937_64(gp.rndSeed);
+    if (gp.rndSeed == 0) {
+        std::random_device rd{};
+        rng.seed(rd());
+    }
+    auto unif = std::uniform_real_distribution<double>(0.0, 1.0);
+
+    // Workspaces are reused, each run overwrites all the factors
+    //
+    ThreadPool pool(gp.nThreads, gp.pinThreads);
+    vector< unique_ptr<SnimModel> > wMdl(pool.size());
+    vector< unique_ptr<StatsSink> > wStats(pool.size());
+    pool.RunOnEach([&](size_t w){
+        wMdl[w].reset(new SnimModel(mdl));
+        wMdl[w]->Compile();
+        wStats[w].reset(new StatsSink(gp.fromTime));
+    });
+
+    // Design points and their outputs for one chunk of runs
+    //
+    vector<double> x;
+    vector<size_t> seeds;
+    vector<double> y;
+
+    auto evaluate = [&](size_t nRuns){
+        y.assign(nRuns * nOut, 0.0);
+        pool.Run(nRuns, [&](size_t run, size_t w){
+            for (size_t i = 0; i < k; ++i)
+                gp.factors[i].Apply(*wMdl[w], x[run * k + i]);
+            wMdl[w]->Compile();         // Again only if a channel appeared or disappeared
+
+            SimulationParameters jsp(sp);
+            jsp.RecordAll();
+            jsp.checkpointEvery = 0;
+            jsp.rndSeed = seeds[run];
+            wMdl[w]->SimulTauLeap(jsp, *wStats[w]);
+
+            double *out = &y[run * nOut];
+            auto st = wStats[w]->Summary();
+            out[0] = st.S;
+            out[1] = st.H;
+            for (size_t s = 1; s <= nSp; ++s)
+                out[1 + s] = wStats[w]->Mean(s);
+        });
+    };
+
+    auto newSeed = [&](){
+        size_t s = rng();
+        return s == 0 ? size_t(1) : s;
+    };
+
+    vector<GsaIndices> res(nOut);
+    for (size_t o = 0; o < nOut; ++o) {
+        res[o].output = o == 0 ? "S" : o == 1 ? "H" : "N" + Convert::T_to_string(o - 1);
+        res[o].first.assign(k, 0.0);
+        res[o].total.assign(k, 0.0);
+        if (gp.morris)
+            res[o].mu.assign(k, 0.0);
+    }
+
+    size_t const chunk = 64;
+
+    if (!gp.morris) {
+        // Each base sample j needs f(A_j), f(B_j) and f(A_j with factor i
+        // from B_j) for every i. All the runs of a sample share the seed
+        // (common random numbers) to reduce the noise of the differences.
+        //
+        size_t const runsPerSample = k + 2;
+        vector<double> mean(nOut, 0.0), m2(nOut, 0.0);
+        size_t n = 0;
+
+        for (size_t start = 0; start < gp.samples; start += chunk) {
+            size_t m = std::min(chunk, gp.samples - start);
+            vector<double> A(m * k), B(m * k);
+            for (auto &a : A) a = unif(rng);
+            for (auto &b : B) b = unif(rng);
+
+            x.resize(m * runsPerSample * k);
+            seeds.resize(m * runsPerSample);
+            for (size_t j = 0; j < m; ++j) {
+                size_t seed = newSeed();
+                for (size_t q = 0; q < runsPerSample; ++q) {
+                    size_t run = j * runsPerSample + q;
+                    seeds[run] = seed;
+                    for (size_t i = 0; i < k; ++i)
+                        x[run * k + i] = (q == 1 || q == i + 2) ? B[j * k + i] : A[j * k + i];
+                }
+            }
+
+            evaluate(m * runsPerSample);
+
+            for (size_t j = 0; j < m; ++j) {
+                double const *fA = &y[(j * runsPerSample) * nOut];
+                double const *fB = &y[(j * runsPerSample + 1) * nOut];
+                for (size_t o = 0; o < nOut; ++o) {
+                    // Welford update of the variance with both A and B outputs
+                    double d = fA[o] - mean[o];
+                    mean[o] += d / (n + 1);
+                    m2[o] += d * (fA[o] - mean[o]);
+                    d = fB[o] - mean[o];
+                    mean[o] += d / (n + 2);
+                    m2[o] += d * (fB[o] - mean[o]);
+
+                    for (size_t i = 0; i < k; ++i) {
+                        double fAB = y[(j * runsPerSample + i + 2) * nOut + o];
+                        res[o].first[i] += fB[o] * (fAB - fA[o]);
+                        res[o].total[i] += (fA[o] - fAB) * (fA[o] - fAB);
+                    }
+                }
+                n += 2;
+            }
+        }
+
+        for (size_t o = 0; o < nOut; ++o) {
+            double var = n > 1 ? m2[o] / (n - 1) : 0.0;
+            res[o].variance = var;
+            for (size_t i = 0; i < k; ++i) {
+                res[o].first[i] = var > 0 ? res[o].first[i] / gp.samples / var : 0.0;
+                res[o].total[i] = var > 0 ? res[o].total[i] / (2.0 * gp.samples) / var : 0.0;
+            }
+        }
+    }
+    else {
+        // Morris trajectories of k+1 points, each step moves one factor by
+        // delta in random order. Elementary effects are reduced with Welford.
+        //
+        if (gp.levels < 2)
+            throw std::invalid_argument("GSA: Morris needs at least 2 levels");
+
+        size_t const runsPerTraj = k + 1;
+        double const delta = gp.levels / (2.0 * (gp.levels - 1));
+        size_t const baseLevels = std::max<size_t>(1, gp.levels / 2);
+        auto level = std::uniform_int_distribution<size_t>(0, baseLevels - 1);
+
+        vector<double> m2(nOut * k, 0.0), mAbs(nOut * k, 0.0);
+        size_t n = 0;
+        vector<size_t> order(k);
+
+        for (size_t start = 0; start < gp.samples; start += chunk) {
+            size_t m = std::min(chunk, gp.samples - start);
+            vector< vector<size_t> > orders(m);
+
+            x.resize(m * runsPerTraj * k);
+            seeds.resize(m * runsPerTraj);
+            for (size_t t = 0; t < m; ++t) {
+                for (size_t i = 0; i < k; ++i)
+                    order[i] = i;
+                std::shuffle(order.begin(), order.end(), rng);
+                orders[t] = order;
+
+                size_t seed = newSeed();
+                double *x0 = &x[t * runsPerTraj * k];
+                for (size_t i = 0; i < k; ++i)
+                    x0[i] = static_cast<double>(level(rng)) / (gp.levels - 1);
+                seeds[t * runsPerTraj] = seed;
+
+                for (size_t q = 1; q < runsPerTraj; ++q) {
+                    double *xq = x0 + q * k;
+                    std::copy(xq - k, xq, xq);
+                    xq[order[q-1]] = std::min(1.0, xq[order[q-1]] + delta);
+                    seeds[t * runsPerTraj + q] = seed;
+                }
+            }
+
+            evaluate(m * runsPerTraj);
+
+            for (size_t t = 0; t < m; ++t) {
+                ++n;
+                for (size_t q = 1; q < runsPerTraj; ++q) {
+                    size_t i = orders[t][q-1];
+                    double const *f0 = &y[(t * runsPerTraj + q - 1) * nOut];
+                    double const *f1 = &y[(t * runsPerTraj + q) * nOut];
+                    for (size_t o = 0; o < nOut; ++o) {
+                        double ee = (f1[o] - f0[o]) / delta;
+                        double d = ee - res[o].mu[i];
+                        res[o].mu[i] += d / n;
+                        m2[o * k + i] += d * (ee - res[o].mu[i]);
+                        mAbs[o * k + i] += (std::abs(ee) - mAbs[o * k + i]) / n;
+                    }
+                }
+            }
+        }
+
+        for (size_t o = 0; o < nOut; ++o)
+            for (size_t i = 0; i < k; ++i) {
+                res[o].first[i] = mAbs[o * k + i];
+                res[o].total[i] = n > 1 ? std::sqrt(m2[o * k + i] / (n - 1)) : 0.0;
+            }
+    }
+
+    if (gp.pinThreads)
+        pool.Report(std::cout);
+
+    return res;
+}
+
+/// Run the analysis from a configuration file and write <output>.indices
+///
+void RunGsa(const std::string &fName, const SweepSpec &overrides){
+    GsaParameters gp(fName);
+
+    SnimModel mdl;
+    mdl.ReadModelParams(gp.modelFile);
+    SimulationParameters sp(gp.simFile);
+    overrides.ApplyJob(0, mdl, sp);
+    mdl.Compile();                      // Shared by the workers, that patch their copies
+
+    auto res = RunGsa(mdl, sp, gp);
+
+    std::ofstream fout(gp.outPrefix + ".indices");
+    if (!fout)
+        throw std::runtime_error("GSA: can't open output file " + gp.outPrefix + ".indices");
+
+    if (gp.morris)
+        fout << "output\tfactor\tmu\tmuStar\tsigma\n";
+    else
+        fout << "output\tfactor\tfirst\ttotal\tvariance\n";
+
+    for (auto const &r : res)
+        for (size_t i = 0; i < gp.factors.size(); ++i) {
+            fout << r.output << "\t" << gp.factors[i].name << "\t";
+            if (gp.morris)
+                fout << r.mu[i] << "\t" << r.first[i] << "\t" << r.total[i] << "\n";
+            else
+                fout << r.first[i] << "\t" << r.total[i] << "\t" << r.variance << "\n";
+        }
+}
+
+} // end namespace
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   sensitivity.h
+  \brief  Global sensitivity analysis (Sobol and Morris) of model parameters
+ */
+#ifndef SNIM_SENSITIVITY_HH_
+#define SNIM_SENSITIVITY_HH_
+
+#include <string>
+#include <vector>
+
+#include "snim.h"
+#include "sweep.h"
+
+namespace snim {
+
+/**
+  \brief A model parameter included in the analysis with its range
+ */
+struct GsaFactor {
+    enum Kind { Omega, Extinction, Immigration };
+
+    Kind kind;
+    std::string name;                   /// Key as written: omega[i,j], e[i] or u[i]
+    size_t row=0;                       /// Species, or row of omega
+    size_t col=0;                       /// Column of omega
+    double min=0.0;
+    double max=1.0;
+
+    /// Set the parameter in the model, x is in [0,1]
+    ///
+    void Apply(SnimModel &mdl, double x) const;
+};
+
+/**
+  \brief Sensitivity analysis settings read from a configuration file
+
+  File structure, name = value # comment:
+
+      model        = model.par          # Base model
+      simulation   = simulationpar.cfg  # Simulation parameters
+      output       = gsa                # Indices go to gsa.indices
+      method       = sobol              # sobol or morris
+      threads      = 0                  # 0 means all the cores
+      pinThreads   = 0                  # 1 pins workers to CPUs, NUMA local buffers
+      samples      = 1000               # Sobol: base samples, Morris: trajectories
+      levels       = 4                  # Morris grid levels
+      fromTime     = 50                 # Evaluation from which outputs are averaged
+      rndSeed      = 0
+      omega[1,2]   = 0 5                # Factors with their range
+      e[1]         = 0.5 2
+      u[3]         = 0 0.1
+
+  The outputs analysed are the richness S, the Shannon diversity H and the
+  mean abundance of each species from evaluation fromTime.
+ */
+struct GsaParameters {
+    std::string modelFile;
+    std::string simFile;
+    std::string outPrefix="gsa";
+    bool morris=false;
+    size_t nThreads=0;
+    bool pinThreads=false;
+    size_t samples=1000;
+    size_t levels=4;
+    size_t fromTime=0;
+    size_t rndSeed=0;
+    std::vector<GsaFactor> factors;
+
+    GsaParameters() {}
+
+    GsaParameters(const std::string &fName);
+
+    /// Add a factor given its key and the string with its range
+    ///
+    void AddFactor(const std::string &key, const std::string &range);
+};
+
+/**
+  \brief Sensitivity indices of one output
+ */
+struct GsaIndices {
+    std::string output;
+    double variance=0.0;                /// Sobol: variance of the output
+    std::vector<double> first;          /// Sobol first order index, Morris mu*
+    std::vector<double> total;          /// Sobol total index, Morris sigma
+    std::vector<double> mu;             /// Morris mean elementary effect
+};
+
+/// Run a Sobol (Saltelli 2010 and Jansen estimators) or Morris analysis.
+/// Design points are generated in chunks and reduced with streaming
+/// estimators, so memory does not grow with the number of samples.
+///
+std::vector<GsaIndices> RunGsa(const SnimModel &mdl, const SimulationParameters &sp,
+                               const GsaParameters &gp);
+
+/// Read the configuration and model, run the analysis and write <output>.indices
+///
+/// \param overrides values set in the model and simulation parameters
+///                  before the analysis (--set)
+///
+void RunGsa(const std::string &fName, const SweepSpec &overrides = SweepSpec());
+
+} /* end namespace */
+
+#endif
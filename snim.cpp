@@ -14,9 +14,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iterator>
 #include "snim.h"
 #include "configfile.h"
+#include "textscan.h"
+#include "threadpool.h"
 
 namespace snim{ 
 
@@ -25,162 +28,456 @@ namespace snim{
 /// \param sp = Parameters of the simulations
 /// \param N  = Output of the model
     
-void SnimModel::SimulTauLeap(const SimulationParameters& sp, matrix<size_t>& N){
+void SnimModel::SimulTauLeap(const SimulationParameters& sp, matrix<size_t>& N) const {
+    MatrixSink out(N);
+    SimulTauLeap(sp, out);
+}
+
+/// Simulation of the model using the TauLeap method, each evaluation is
+/// passed to the sink as soon as it is calculated so only the current state
+/// is kept in memory
+///
+/// \param sp   = Parameters of the simulations
+/// \param out  = Receives the initial conditions and each evaluation
+/// \param from = Checkpoint to continue from or nullptr
+    
+void SnimModel::SimulTauLeap(const SimulationParameters& sp, TrajectorySink& out,
+                             const Checkpoint *from) const {
     using namespace std;
-    // if output matrix undefined define it with the correct dimensions
-    // 
-    if (omega.rows() != N.rows() || (sp.nEvals+1) != N.cols()){
-        
-        N.resize(omega.rows(),sp.nEvals+1);
-    }
 
-    // Initialize output matrix with initial populations
+    // Number of species
+    auto nSpecies = omega.rows();
+
+    // Column with the current populations passed to the sink
+    //
+    vector<size_t> N(nSpecies);
+
+    // Initialize with initial populations
     //
-    N(0,0)=communitySize;
+    N[0]=communitySize;
     if(sp.iniCond.size()==1)
-        for( size_t i=1; i<N.rows(); ++i){
-            N(i,0)= sp.iniCond[0];
-            N(0,0)-=sp.iniCond[0];
+        for( size_t i=1; i<nSpecies; ++i){
+            N[i]= sp.iniCond[0];
+            N[0]-=sp.iniCond[0];
         }
     else {
-        if ((sp.iniCond.size()+1) != omega.rows()) {
+        if ((sp.iniCond.size()+1) != nSpecies) {
             std::ostringstream message;
             message << "Different no. of species in Initial conditions: "
-                    << "expected " << omega.rows()-1 << ", "
+                    << "expected " << nSpecies-1 << ", "
                     << "got " << sp.iniCond.size() << ".";
 
             throw std::invalid_argument(message.str());
         }
 
-        for( size_t i=1; i<N.rows(); ++i){
-             N(i,0)= sp.iniCond[i-1];
-             N(0,0)-=sp.iniCond[i-1];
+        for( size_t i=1; i<nSpecies; ++i){
+             N[i]= sp.iniCond[i-1];
+             N[0]-=sp.iniCond[i-1];
         }
     }
+
+    // Rows and evaluations passed to the sink, the rest are simulated but
+    // never stored
+    //
+    if (sp.recordStride == 0)
+        throw std::invalid_argument("recordStride must be greater than 0");
+    for (auto s : sp.recordSpecies)
+        if (s >= nSpecies) {
+            std::ostringstream message;
+            message << "Species " << s << " in recordSpecies is greater than the number of species "
+                    << nSpecies-1 << ".";
+            throw std::invalid_argument(message.str());
+        }
+    bool allSpecies = sp.recordSpecies.empty();
+    vector<size_t> rec(allSpecies ? 0 : sp.recordSpecies.size());
+    size_t col = 0;
+    auto record = [&](size_t y){
+        if (!sp.Records(y))
+            return;
+        if (allSpecies)
+            out.Column(col++, N.data());
+        else {
+            for (size_t i = 0; i < rec.size(); ++i)
+                rec[i] = N[sp.recordSpecies[i]];
+            out.Column(col++, rec.data());
+        }
+    };
+
     // Setup random number generator with random seed
     // 
-    auto rng = std::mt19937_64(sp.rndSeed);
-    if(sp.rndSeed==0) {
+    size_t seed = sp.rndSeed;
+    if(seed==0) {
         std::random_device rd{};
-        rng.seed(rd());
+        seed = rd();
+    }
+    auto rng = std::mt19937_64(seed);
+
+    // Positive interactions of the matrix, in the order of the rows, with
+    // their net coefficient omega(s,r)-omega(r,s)
+    //
+    auto cm = GetCompiled();
+
+    // With reorderSpecies the simulation runs on the species renumbered by
+    // BandwidthOrder(), order[k] is the species simulated as k. The output
+    // and the checkpoints keep the original numbers.
+    //
+    vector<uint32_t> order;
+    vector<float> ordE, ordU;
+    const float *ext = e.data(), *imm = u.data();
+    if (sp.reorderSpecies) {
+        order = BandwidthOrder(*cm);
+        cm = std::make_shared<CompiledModel>(omega.Permuted(order));
+        for (size_t k = 1; k < nSpecies; ++k) {
+            ordE.push_back(e[order[k]-1]);
+            ordU.push_back(u[order[k]-1]);
+        }
+        ext = ordE.data();
+        imm = ordU.data();
+    }
+    const CompiledModel &channels = *cm;
+
+    // With componentThreads the components of the model are simulated in
+    // parallel, each one with its own random generator seeded with seed plus
+    // its number, so the result does not depend on the number of threads
+    //
+    bool byComponent = sp.componentThreads > 0;
+    ModelComponents comps;
+    vector<std::mt19937_64> compRng;
+    if (byComponent) {
+        comps = FindComponents(channels);
+        for (size_t c = 0; c < comps.Count(); ++c)
+            compRng.emplace_back(seed + c);
+    }
+
+    // Continue a simulation: the populations, random generator and output
+    // are restored so the rest of the run is the same as without interruption
+    //
+    size_t firstEval = 0;
+    if (from) {
+        if (from->modelHash != Hash() || from->state.size() != nSpecies)
+            throw std::invalid_argument("The checkpoint was saved with another model");
+        if (from->tau != sp.tau || from->eval > sp.nEvals)
+            throw std::invalid_argument("The checkpoint was saved with other simulation parameters");
+        if (!from->outputFormat.empty() &&
+            (from->outputFormat != sp.outputFormat || from->recordStart != sp.recordStart ||
+             from->recordStride != sp.recordStride || from->recordSpecies.size() != sp.recordSpecies.size() ||
+             !std::equal(sp.recordSpecies.begin(), sp.recordSpecies.end(), from->recordSpecies.begin())))
+            throw std::invalid_argument("The checkpoint was saved with another output format or recording settings");
+
+        std::copy(from->state.begin(), from->state.end(), N.begin());
+        // The state of the generators starts with the options that change
+        // the order of the random numbers
+        std::istringstream is(from->rngState);
+        auto savedWith = [&](const string &option){
+            auto pos = is.tellg();
+            string tag;
+            if (is >> tag && tag == option)
+                return true;
+            is.clear();
+            is.seekg(pos);
+            return false;
+        };
+        if (savedWith("reordered") != sp.reorderSpecies)
+            throw std::invalid_argument("The checkpoint was saved with another value of reorderSpecies");
+        if (savedWith("components") != byComponent)
+            throw std::invalid_argument("The checkpoint was saved with another value of componentThreads");
+        if (byComponent) {
+            size_t nRng = 0;
+            is >> nRng;
+            if (nRng != compRng.size())
+                throw std::invalid_argument("The checkpoint was saved with another model");
+            for (auto &g : compRng)
+                is >> g;
+        }
+        else
+            is >> rng;
+        seed = from->seed;
+        firstEval = from->eval;
+        col = from->col;
+    }
+
+    TrajectoryInfo info;
+    info.nRows = allSpecies ? nSpecies : rec.size();
+    info.nCols = sp.RecordedEvals();
+    info.seed = seed;
+    info.maxCount = communitySize;
+    info.species = sp.recordSpecies;
+    info.firstEval = sp.recordStart;
+    info.evalStride = sp.recordStride;
+    if (from)
+        out.Resume(info, col, from->outputSize);
+    else {
+        out.Begin(info);
+        record(0);
     }
+
+    auto saveCheckpoint = [&](size_t evalsDone){
+        Checkpoint chk;
+        chk.modelHash = Hash();
+        chk.seed = seed;
+        chk.tau = sp.tau;
+        chk.eval = evalsDone;
+        chk.col = col;
+        chk.outputSize = out.Sync();
+        chk.state.assign(N.begin(), N.end());
+        chk.recordStart = sp.recordStart;
+        chk.recordStride = sp.recordStride;
+        chk.recordSpecies.assign(sp.recordSpecies.begin(), sp.recordSpecies.end());
+        chk.outputFormat = sp.outputFormat;
+        std::ostringstream os;
+        if (sp.reorderSpecies)
+            os << "reordered ";
+        if (byComponent) {
+            os << "components " << compRng.size();
+            for (auto &g : compRng)
+                os << ' ' << g;
+        }
+        else
+            os << rng;
+        chk.rngState = os.str();
+        chk.Save(sp.checkpointFile);
+    };
    
     // Number of steps for each model evaluation 
     auto nSteps = 1.0 / sp.tau;
     
-    // Number of species
-    auto nSpecies = omega.rows();
-    
-    // Change in number of individuals for each event
-    //
-    matrix<size_t> intDelta(nSpecies,nSpecies,0.0);
-    
-    // Vector with only the non-zero elements of the matrix
+    // Individuals gained and lost by each species through interactions in
+    // one step, the sums by row and column of the matrix of events
     //
-    vector< pair<size_t,size_t>> actualInteractions;
-            
-    for(auto s=1; s<nSpecies; ++s)
-            for( auto r=0; r<nSpecies; ++r)
-                if(omega(s,r)>0) {
-                    actualInteractions.emplace_back(s,r);//  
-                } 
+    vector<size_t> intGain(nSpecies), intLoss(nSpecies);
 
-    // Vectors for extinction and immigration 
+    // Populations during an evaluation, starting at a cache line
     //
-   
+    matrix <long long int, AlignedStorage> S(nSpecies,1);
 
-    // Simulate the model - Calculate the transitions with poison random numbers
+    // One step of a block of species that interact only with each other and
+    // the empty space: the rates are calculated with the state at the start
+    // of the step and S(0) is not changed. Returns the change of the number
+    // of individuals of the block.
     //
-    for (auto y = 0; y < (sp.nEvals) ; ++y){
+    auto stepBlock = [&](const uint32_t *block, size_t nBlock, std::mt19937_64 &g) -> long long int {
+        for(size_t i=0; i<nBlock; ++i){
+            intGain[block[i]] = 0;
+            intLoss[block[i]] = 0;
+        }
 
-        // Initialize the internal matrix with N
-        matrix <long long int> S(nSpecies,1);
-        for(auto i=0u; i<S.rows(); ++i)
-            S(i)=N(i,y);
-        
-        for(auto n=0; n < nSteps; ++n) {
-            
-//            cout << endl << "Inner Steps: " << n << endl;    
- 
-            // Calculate interactions between species 
-            //
-            // Species 0 is the empty space
-            //
-            for(auto t:actualInteractions){
-                auto s=t.first;
-                auto r=t.second;
-                double evRate =(omega(s,r)-omega(r,s))*S(s)*S(r)/communitySize;
-
-//                cout << s << " - " << r << " - " << omega(s,r) << " - " << omega(r,s) << " - " << S(s) << " - " << S(r) << endl;
-//                cout <<  evRate << " - "<< intDelta(s,r) << endl;
+        // Calculate interactions between species 
+        //
+        // Species 0 is the empty space, what it loses is not used
+        //
+        // Predators that are absent have all their rates 0 and are
+        // skipped, no random numbers are drawn for them in any case
+        //
+        for(size_t i=0; i<nBlock; ++i){
+            auto s = block[i];
+            if(S(s)==0)
+                continue;
+            for(size_t c=channels.PredatorBegin(s); c<channels.PredatorEnd(s); ++c){
+                auto const &t=channels[c];
+                auto r=t.r;
+                double evRate =t.net*S(s)*S(r)/communitySize;
 
                 if( evRate > 0.0 ){  
                     auto pois = std::poisson_distribution<size_t>(evRate*sp.tau);
-                    intDelta(s,r) = pois(rng);
+                    auto d = pois(g);
+                    intGain[s] += d;
+                    if (r)
+                        intLoss[r] += d;
                 }
-                else
-                    intDelta(s,r) = 0.0;
-                    
-                
             }
-//            cout << "intDelta :" << intDelta << endl;
+        }
+        
+        long long int sumDelta = 0;
+        // Calculate inmigration extinction and sum interactions
+        //            
+        for(size_t i=0; i<nBlock; ++i){
+            auto s = block[i];
+            
+            // Calculate extinction
+            double evRate = 0;
+            evRate = S(s)*ext[s-1];
+            size_t exDelta = 0;
+            if(evRate > 0.0) {
+                auto pois = std::poisson_distribution<size_t>(evRate*sp.tau);
+                exDelta= pois(g);
+            }
+            
+            // Calculate immigration 
+            evRate = S(0)*imm[s-1];
+            size_t imDelta=0;
+            if( evRate > 0.0) {
+                auto pois = std::poisson_distribution<size_t>(evRate*sp.tau);
+                imDelta= pois(g);
+            }
+            // Calculate new population values
+            long long int totDelta = imDelta - exDelta + intGain[s] - intLoss[s];
+            if( S(s)+totDelta >0){
+                S(s) += totDelta;
+            }
+            else
+                S(s) =0;
+            
+            sumDelta += totDelta;
+        }
+        return sumDelta;
+    };
+
+    // All the species form one block in the serial simulation. Components
+    // are distributed in groups of about the same number of channels, one
+    // group for each thread.
+    //
+    vector<uint32_t> everySpecies(nSpecies > 0 ? nSpecies - 1 : 0);
+    for (size_t s = 1; s < nSpecies; ++s)
+        everySpecies[s-1] = s;
+
+    vector< vector<size_t> > groups;
+    unique_ptr<ThreadPool> pool;
+    if (byComponent) {
+        size_t nGroups = std::min<size_t>(sp.componentThreads, comps.Count());
+        groups.resize(nGroups);
+        vector<size_t> byCost(comps.Count());
+        for (size_t c = 0; c < byCost.size(); ++c)
+            byCost[c] = c;
+        auto cost = [&](size_t c){ return comps.channels[c] + comps.Size(c); };
+        std::stable_sort(byCost.begin(), byCost.end(), [&](size_t a, size_t b){ return cost(a) > cost(b); });
+        vector<size_t> load(nGroups, 0);
+        for (auto c : byCost) {
+            auto g = std::min_element(load.begin(), load.end()) - load.begin();
+            groups[g].push_back(c);
+            load[g] += cost(c);
+        }
+        if (nGroups > 1)
+            pool.reset(new ThreadPool(nGroups));
+    }
+    vector<long long int> groupDelta(groups.size());
+    auto stepGroup = [&](size_t g, size_t){
+        groupDelta[g] = 0;
+        for (auto c : groups[g])
+            groupDelta[g] += stepBlock(comps.Species(c), comps.Size(c), compRng[c]);
+    };
+
+    // Simulate the model - Calculate the transitions with poison random numbers
+    //
+    for (size_t y = firstEval; y < sp.nEvals ; ++y){
+
+        // Initialize the internal state with N
+        if (order.empty())
+            for(auto i=0u; i<S.rows(); ++i)
+                S(i)=N[i];
+        else
+            for(auto i=0u; i<S.rows(); ++i)
+                S(i)=N[order[i]];
+        
+        for(auto n=0; n < nSteps; ++n) {
             
             long long int sumDelta = 0;
-            // Calculate inmigration extinction and sum interactions
-            //            
-            for(auto s=1; s<nSpecies; ++s){
-                
-                // Calculate extinction
-                double evRate = 0;
-                evRate = S(s)*e[s-1];
-                size_t exDelta = 0;
-                if(evRate > 0.0) {
-                    auto pois = std::poisson_distribution<size_t>(evRate*sp.tau);
-                    exDelta= pois(rng);
-                }
-                
-                // Calculate immigration 
-                evRate = S(0)*u[s-1];
-                size_t imDelta=0;
-                if( evRate > 0.0) {
-                    auto pois = std::poisson_distribution<size_t>(evRate*sp.tau);
-                    imDelta= pois(rng);
-                }
-                // Calculate new population values
-                long long int totDelta = imDelta - exDelta + intDelta.row_sum(s) - intDelta.col_sum(s);
-                if( S(s)+totDelta >0){
-                    S(s) += totDelta;
-                }
+            if (!byComponent)
+                sumDelta = stepBlock(everySpecies.data(), everySpecies.size(), rng);
+            else {
+                if (pool)
+                    pool->Run(groups.size(), stepGroup);
                 else
-                    S(s) =0;
-                
-                sumDelta += totDelta;
-//                cout <<"S: "<< S << endl;        
-//                cout << s << " - " << imDelta << " - " << exDelta << " - " << intDelta.row_sum(s) << " - " << intDelta.col_sum(s) << " - " 
-//                                << totDelta << " - " << endl;
-            
-                
+                    for (size_t g = 0; g < groups.size(); ++g)
+                        stepGroup(g, 0);
+                for (auto d : groupDelta)
+                    sumDelta += d;
             }
             
             if(S(0) - sumDelta < 0 )
                 S(0) = 0;
             else
                 S(0)-=sumDelta;
-
-//            cout <<"S: "<< S << endl;        
         }
 
-//        cout << "Outer Step: " << y+1 << endl; 
-        for(auto i=0u; i<S.rows(); ++i){
-            N(i,y+1)=S(i);
-//            cout << N(i,y+1) << endl;    
-        }
+        if (order.empty())
+            for(auto i=0u; i<S.rows(); ++i)
+                N[i]=S(i);
+        else
+            for(auto i=0u; i<S.rows(); ++i)
+                N[order[i]]=S(i);
+        record(y+1);
+
+        if (sp.checkpointEvery > 0 && (y+1) % sp.checkpointEvery == 0)
+            saveCheckpoint(y+1);
     }
-            
+
+    out.End();
 }
        
+void SnimModel::SetOmega(size_t row, size_t col, float val){
+    float old = omega(row,col);
+    omega.Set(row,col,val);
+    if (!compiled)
+        return;
+    if (row >= 1 && (old > 0) != (val > 0)) {
+        compiled.reset();
+        return;
+    }
+
+    // Copies of the model share the compiled model until one of them changes it
+    if (compiled.use_count() > 1)
+        compiled = std::make_shared<CompiledModel>(*compiled);
+
+    size_t c = compiled->Find(row, col);
+    if (c < compiled->Channels())
+        compiled->SetNet(c, omega(row,col) - omega(col,row));
+    c = compiled->Find(col, row);
+    if (c < compiled->Channels())
+        compiled->SetNet(c, omega(col,row) - omega(row,col));
+}
+
+std::vector< std::pair<size_t,size_t> > SnimModel::GetInteractionIndex() const {
+    std::vector< std::pair<size_t,size_t> > idx;
+    for (size_t r = 1; r < omega.rows(); ++r)
+        for (size_t i = omega.RowBegin(r); i < omega.RowEnd(r); ++i)
+            if (omega.Col(i) >= 1 && omega.Value(i) > 0)
+                idx.emplace_back(r, omega.Col(i));
+
+    std::sort(idx.begin(), idx.end(), [](const std::pair<size_t,size_t> &a, const std::pair<size_t,size_t> &b){
+        return std::tie(a.second, a.first) < std::tie(b.second, b.first);
+    });
+    return idx;
+}
+
+uint64_t SnimModel::Hash() const {
+    uint64_t h = 14695981039346656037ULL;
+    auto add = [&h](const void *p, size_t bytes){
+        auto c = static_cast<const unsigned char*>(p);
+        for (size_t i = 0; i < bytes; ++i) {
+            h ^= c[i];
+            h *= 1099511628211ULL;
+        }
+    };
+    uint64_t dims[2] = {nSpecies, communitySize};
+    add(dims, sizeof(dims));
+    add(u.data(), u.size() * sizeof(float));
+    add(e.data(), e.size() * sizeof(float));
+    for (size_t r = 0; r < omega.rows(); ++r)
+        for (size_t i = omega.RowBegin(r); i < omega.RowEnd(r); ++i) {
+            if (omega.Value(i) == 0)
+                continue;
+            uint32_t rc[2] = {static_cast<uint32_t>(r), omega.Col(i)};
+            float v = omega.Value(i);
+            add(rc, sizeof(rc));
+            add(&v, sizeof(v));
+        }
+    return h;
+}
+
 std::ostream& operator<<(std::ostream& os,  const SnimModel &  s) {
-  os << "[Omega]\n" << s.omega << std::endl;
+  // Dense rows, with the format of matrix
+  os << "[Omega]\n";
+  std::vector<float> row(s.omega.cols());
+  for (size_t r = 0; r < s.omega.rows(); ++r) {
+    std::fill(row.begin(), row.end(), 0.0f);
+    for (size_t i = s.omega.RowBegin(r); i < s.omega.RowEnd(r); ++i)
+        row[s.omega.Col(i)] = s.omega.Value(i);
+    os << '[';
+    for (size_t c = 0; c < row.size(); ++c)
+        os << (c > 0 ? ", " : "") << row[c];
+    os << "]\n";
+  }
+  os << std::endl;
   
   os << "[Extinction]\n";
   os << s.e << std::endl;
@@ -217,6 +514,25 @@ SimulationParameters::SimulationParameters(const std::string &fName){
     nEvals  = cfg.getValueOfKey<size_t>("nEvals"); // number of evaluations steps
     
     tau     = cfg.getValueOfKey<double>("tau");
+
+    outputFormat = cfg.getValueOfKey<std::string>("outputFormat", "tsv");
+
+    recordStart  = cfg.getValueOfKey<size_t>("recordStart", 0);
+    recordStride = cfg.getValueOfKey<size_t>("recordStride", 1);
+    statsFrom    = cfg.getValueOfKey<size_t>("statsFrom", 0);
+    skipZeros    = cfg.getValueOfKey<int>("skipZeros", 0) != 0;
+
+    checkpointEvery = cfg.getValueOfKey<size_t>("checkpointEvery", 0);
+    checkpointFile  = cfg.getValueOfKey<std::string>("checkpointFile", "snim.chk");
+    modelCache      = cfg.getValueOfKey<int>("modelCache", 0) != 0;
+    componentThreads = cfg.getValueOfKey<size_t>("componentThreads", 0);
+    reorderSpecies  = cfg.getValueOfKey<int>("reorderSpecies", 0) != 0;
+    if( cfg.keyExists("recordSpecies")){
+        std::istringstream strline(cfg.getValueOfKey<std::string>("recordSpecies"));
+        size_t tempd=0;
+        while (strline >> tempd)
+            recordSpecies.push_back(tempd);
+    }
     
     if( cfg.keyExists("iniCond")){
         auto iniCondStr = cfg.getValueOfKey<std::string>("iniCond");
@@ -239,50 +555,101 @@ SimulationParameters::SimulationParameters(const std::string &fName){
 /// <Extinction rates> Vector of NumberOfSpecies 
 /// <Interaction matrix> Matrix of NumberOfSpecies+1 by NumberOfSpecies+1  
 ///
+/// With the word edges after the community size the interaction matrix is
+/// an edge list instead, one element by line and the rest are zero:
+///
+/// NumberOfSpecies CommunitySize edges
+/// <inmigration rates> Vector of NumberOfSpecies 
+/// <Extinction rates> Vector of NumberOfSpecies 
+/// row col omega(row,col)   rows and cols from 0 (empty space) to NumberOfSpecies
+///
+/// A line that starts with "names" can be anywhere after the first line, it
+/// has the names of species 1 to NumberOfSpecies
+///
 void SnimModel::ReadModelParams(const std::string &fName) {
-    ConfigFile cfg;
+    if (IsBinaryModel(fName)) {
+        ReadBinaryModel(fName);
+        return;
+    }
+
+    OmegaReader om;
+    edgeList = false;
+    compiled.reset();
     
-    std::ifstream file;
-    file.open(fName.c_str());
-    if (!file)
-            exitWithError("Model Parameters File [" + fName + "] couldn't be found!\n");
+    // The file is read in blocks and the lines are scanned in the buffer, so
+    // memory is the non-zero elements and one line
+    LineReader lines(fName);
+    if (!lines.IsOpen())
+        throw std::runtime_error("Model Parameters File [" + fName + "] couldn't be found");
 
-    std::string line;
+    const char *begin, *end;
     size_t lineNo = 0;
-    while (std::getline(file, line)) {
-        std::string temp = line;
-
-        if (temp.empty())
+    while (lines.Next(begin, end)) {
+        if (OnlyBlanks(begin, end))
                 continue;
 
-        cfg.removeComment(temp);
-        if (cfg.onlyWhitespace(temp))
-                continue;
+        const char *p = begin, *wBegin, *wEnd;
+        if (ScanWord(p, end, wBegin, wEnd) && wEnd - wBegin == 5 && std::memcmp(wBegin, "names", 5) == 0) {
+            ReadSpeciesNames(p, end);
+            continue;
+        }
         lineNo++;
 
-        ReadModelParamsLine(temp, lineNo);
+        ReadModelParamsLine(begin, end, lineNo, om);
     }
 
+    // The matrix is built without a dense copy
+    if (edgeList)
+        omega = SparseMatrix::FromTriplets(nSpecies+1, om.elems);
+    else {
+        // Missing rows at the end are empty
+        om.rowStart.resize(nSpecies+2, om.cols.size());
+        omega = SparseMatrix::FromRows(nSpecies+1, std::move(om.rowStart), std::move(om.cols), std::move(om.vals));
+    }
+}
+
+/// Names of species 1 to nSpecies, species 0 is named 0 as in the R functions
+///
+void SnimModel::ReadSpeciesNames(const char *p, const char *end){
+    names.assign(1, "0");
+    const char *wBegin, *wEnd;
+    while (ScanWord(p, end, wBegin, wEnd))
+        names.emplace_back(wBegin, wEnd);
+    if (names.size() != nSpecies+1) {
+        std::ostringstream message;
+        message << "Wrong number of species names: "
+                << "expected " << nSpecies << ", "
+                << "got " << names.size()-1 << ".";
+
+        throw std::invalid_argument(message.str());
+    }
 }
 
 /// Auxiliary function of ReadModelParams extract values from lines
 ///
-/// \param line String with the line to be extracted
+/// \param begin,end Line to be extracted, without its comment
 /// \param lineNo Number of the line with information comments lines are skipped
+/// \param om     Elements of the interaction matrix read
 ///
-void SnimModel::ReadModelParamsLine(const std::string& line, const size_t lineNo){
-    using namespace std;
-    istringstream strline(line);
+void SnimModel::ReadModelParamsLine(const char *begin, const char *end, const size_t lineNo,
+                                    OmegaReader &om){
+    const char *p = begin;
     double tempd=0;
     switch(lineNo){
-        case 1:
-            strline >> nSpecies;
-            strline >> communitySize;
+        case 1: {
+            uint64_t n=0, size=0;
+            bool ok = ScanUnsigned(p, end, n) && ScanUnsigned(p, end, size);
+            nSpecies = n;
+            communitySize = size;
+            const char *wBegin, *wEnd;
+            if (ok && ScanWord(p, end, wBegin, wEnd))
+                edgeList = std::string(wBegin, wEnd) == "edges";
             break;
+        }
             
         case 2:                         // Read immigration vector
             u.reserve(nSpecies);
-            while (strline >> tempd) // Will read up to eof()
+            while (ScanDouble(p, end, tempd)) // Will read up to the end of the line
                 u.push_back(tempd);
             if (u.size() != nSpecies) {
                 std::ostringstream message;
@@ -296,7 +663,7 @@ void SnimModel::ReadModelParamsLine(const std::string& line, const size_t lineNo
             
         case 3:                         // Read extinction vector
             e.reserve(nSpecies);
-            while (strline >> tempd)    // Will read up to eof()
+            while (ScanDouble(p, end, tempd)) // Will read up to the end of the line
                 e.push_back(tempd);
             
             if (e.size() != nSpecies) {
@@ -311,18 +678,33 @@ void SnimModel::ReadModelParamsLine(const std::string& line, const size_t lineNo
             break;
             
        default:                        // Read a line of the interaction matrix omega 
-           if(omega.size()!= (nSpecies+1)*(nSpecies+1) )
-           {
-               omega.resize(nSpecies+1,nSpecies+1);
+           if (edgeList) {
+               uint64_t row=0, col=0;
+               if (!(ScanUnsigned(p, end, row) && ScanUnsigned(p, end, col) && ScanDouble(p, end, tempd))
+                   || row > nSpecies || col > nSpecies) {
+                   std::ostringstream message;
+                   message << "Wrong interaction in edge list: [" << std::string(begin, end) << "], "
+                           << "expected row col value with row and col from 0 to " << nSpecies << ".";
+
+                   throw std::invalid_argument(message.str());
+               }
+               om.elems.push_back({uint32_t(row), uint32_t(col), float(tempd)});
+               break;
            }
 
            auto row=lineNo-4; 
-           if(row < omega.rows())
-              for( auto i=0u; i<omega.cols(); ++i ){
-                strline >> tempd;
-                omega(row,i)= tempd;
-                if(strline.eof()) break; 
+           if(row <= nSpecies) {
+              if (om.rowStart.empty())
+                  om.rowStart.push_back(0);
+              for( auto i=0u; i<=nSpecies; ++i ){
+                if (!ScanDouble(p, end, tempd)) break;
+                if(float(tempd) != 0) {
+                    om.cols.push_back(i);
+                    om.vals.push_back(tempd);
+                }
               } 
+              om.rowStart.push_back(om.cols.size());
+           }
     }
 }
 
@@ -32,8 +32,15 @@
 #include <sstream>
 #include <cerrno>
 #include <utility>
+#include <cstdint>
+#include <memory>
 
 #include "matrix.h"
+#include "sparsematrix.h"
+#include "compiledmodel.h"
+#include "mappedfile.h"
+#include "trajectory.h"
+#include "checkpoint.h"
 
 namespace snim {
 
@@ -54,6 +61,18 @@ struct SimulationParameters {
     size_t nEvals=0;                    /// number of evaluations steps
     double tau=0.0;                     /// Tau method steps  
     std::vector<size_t> iniCond;        /// Initial conditions 
+    std::string outputFormat="tsv";     /// Format of the output file, see MakeFileSink
+    size_t recordStart=0;               /// First evaluation recorded, 0 are the initial conditions
+    size_t recordStride=1;              /// Record one of every recordStride evaluations
+    std::vector<size_t> recordSpecies;  /// Species recorded (0 is empty space), empty for all
+    size_t statsFrom=0;                 /// First evaluation used by the stats output format
+    bool skipZeros=false;               /// The long output format leaves out zero densities
+    size_t checkpointEvery=0;           /// Evaluations between checkpoints, 0 for none
+    std::string checkpointFile;         /// File where the checkpoints are saved
+    bool modelCache=false;              /// Keep the compiled model file in <model file>.snc
+    size_t componentThreads=0;          /// Threads that simulate the independent components of the
+                                        /// model, 0 for the serial simulation
+    bool reorderSpecies=false;          /// Simulate the species in the order of BandwidthOrder()
 
     
     /// Read simulations parameters from configuration file
@@ -71,40 +90,125 @@ struct SimulationParameters {
         std::copy(s.begin()+3, s.end(),std::back_inserter(iniCond));       
     };
 
+    /// Whether evaluation y (0 are the initial conditions) is passed to the output
+    ///
+    bool Records(size_t y) const {
+        return y >= recordStart && (y - recordStart) % recordStride == 0;
+    }
+
+    /// Number of evaluations passed to the output
+    ///
+    size_t RecordedEvals() const {
+        return recordStart > nEvals ? 0 : (nEvals - recordStart) / recordStride + 1;
+    }
+
+    /// Record all species and evaluations, for analyses that need the whole trajectory
+    ///
+    void RecordAll() {
+        recordStart = 0;
+        recordStride = 1;
+        recordSpecies.clear();
+    }
+
     friend std::ostream& operator<<(std::ostream&,  const SimulationParameters&);
 
 };
 
+/**
+  \brief Parameters of a random food web generated instead of reading a model
+         file, read from the simulation configuration file:
+
+      network         = niche   # niche, cascade, random or mixed, no key to read the model file
+      networkSpecies  = 100     # Number of species
+      networkSize     = 100000  # Community size
+      connectance     = 0.1     # Links / species^2
+      networkSeed     = 1       # Seed of the generator, 0 means a random seed
+      predationRate   = 1.0     # Predator on prey coefficients are uniform in (0, predationRate]
+      growthRate      = 1.0     # Basal species on empty space, uniform in (0, growthRate]
+      basalFraction   = 0.2     # With random, fraction of species that eat no other species
+      competition     = 0.2     # With mixed, probability that two basal species compete
+      competitionRate = 0.5     # Competition coefficients, uniform in (0, competitionRate]
+      immigrationRate = 0.01    # Immigration of every species
+      extinctionRate  = 0.1     # Extinction of every species
+ */
+struct NetworkParameters {
+    std::string type;                   /// Empty if the model is read from a file
+    size_t nSpecies=0;
+    size_t communitySize=0;
+    double connectance=0.1;
+    size_t seed=0;
+    double predationRate=1.0;
+    double growthRate=1.0;
+    double basalFraction=0.2;
+    double competition=0.2;
+    double competitionRate=0.5;
+    double immigrationRate=0.01;
+    double extinctionRate=0.1;
+
+    NetworkParameters() {}
+
+    /// Read the network keys of a simulation configuration file
+    ///
+    explicit NetworkParameters(const std::string &fName);
+
+    /// Whether a network is generated instead of reading the model file
+    ///
+    bool Active() const { return !type.empty(); }
+};
+
+/// Whether the file starts like a binary model file
+///
+bool IsBinaryModel(const std::string &fName);
+
 class SnimModel {
 
     // Model parameters 
     //
     
-    matrix <float> omega;       // Interaction matrix
+    SparseMatrix omega;         // Interaction matrix, only the non-zero elements
     std::vector<float> e;       // extinction vector
     std::vector<float> u;       // immigration parameter 
     size_t communitySize=0;           // Total size of the community
     size_t nSpecies=0;                 // Number of species
+    std::vector<std::string> names;    // Species names from 0 (empty space), optional
     
 
-    void ReadModelParamsLine(const std::string &line, size_t const lineNo);
+    bool edgeList=false;               // The model file has the interactions as row col value
+    std::shared_ptr<CompiledModel> compiled;   // Loaded with the model, shared by copies until patched
+    // Elements of omega while a model file is read: the rows of the dense
+    // format go straight to the compressed row arrays, an edge list can be in
+    // any order and is kept as triplets
+    struct OmegaReader {
+        std::vector<SparseMatrix::Triplet> elems;
+        std::vector<uint64_t> rowStart;
+        std::vector<uint32_t> cols;
+        std::vector<float> vals;
+    };
+    void ReadModelParamsLine(const char *begin, const char *end, size_t const lineNo,
+                             OmegaReader &om);
+    void ReadSpeciesNames(const char *p, const char *end);
+    void ReadBinaryModel(const std::string &fName);
+    void ReadBinaryModel(const std::string &fName, std::shared_ptr<MappedFile> file);
 
     
 public:
   SnimModel() : omega(), e(),u(), communitySize(0), nSpecies(0){}
 
-  SnimModel(size_t nsp, size_t comSize) : omega(nsp+1,nsp+1), e(nsp),u(nsp), communitySize(comSize), nSpecies(nsp){}
+  SnimModel(size_t nsp, size_t comSize) : omega(nsp+1), e(nsp),u(nsp), communitySize(comSize), nSpecies(nsp){}
   
-  SnimModel(const SnimModel& s) : omega(s.omega), e(s.e),u(s.u), communitySize(s.communitySize), nSpecies(s.nSpecies) {}
+  SnimModel(const SnimModel& s) : omega(s.omega), e(s.e),u(s.u), communitySize(s.communitySize), nSpecies(s.nSpecies),
+      names(s.names), compiled(s.compiled) {}
 
   SnimModel& operator=(const SnimModel& s){
     if(this == &s )
         return *this;
-    assert(omega.size()== s.omega.size());
+    assert(omega.rows()== s.omega.rows());
     omega = s.omega;
     e = s.e;
     u = s.u;
     nSpecies = s.nSpecies;
+    names = s.names;
+    compiled = s.compiled;
     return *this;
   }
   
@@ -112,27 +216,47 @@ public:
   \brief Set Interaction matrix in row-wise order
   */
   void SetOmega( std::initializer_list<float> const& om) {
-//      matrix<float> temp(omega.rows(),omega.cols(),om);  
-//      omega = temp;
-      if (om.size() != omega.size()) {
+      size_t n = omega.rows();
+      if (om.size() != n*n) {
             std::ostringstream message;
             message << "Different no. of elements: "
-                    << "expected " << omega.size() << ", "
+                    << "expected " << n*n << ", "
                     << "got " << om.size() << ".";
 
             throw std::invalid_argument(message.str());
         }
 
-   
-      // Standard assign omega = om is column-wise so I have to do it manually
-      // in row-wise order
-      //
+      std::vector<SparseMatrix::Triplet> elems;
       auto it=begin(om); 
-      for (auto i = 0; i<omega.rows(); ++i)
-        for (auto j = 0; j<omega.cols(); j++)
-            omega(i,j) = *it++;
+      for (uint32_t i = 0; i<n; ++i)
+        for (uint32_t j = 0; j<n; j++, ++it)
+            if (*it != 0)
+                elems.push_back({i, j, *it});
+      omega = SparseMatrix::FromTriplets(n, elems);
+      compiled.reset();
   };
   
+  /**
+  \brief Set one interaction coefficient omega(row,col)
+
+  Only the net rates of the channels (row,col) and (col,row) of the compiled
+  model are updated. If a coefficient of a species changes between zero and
+  positive a channel appears or disappears and the model is compiled again
+  when it is used.
+  */
+  void SetOmega(size_t row, size_t col, float val);
+
+  float GetOmega(size_t row, size_t col) const {
+      return omega(row,col);
+  };
+
+  /**
+  \brief Positions of the positive interactions between species (row,col >= 1)
+         in column-major order, the order used by the R functions to map a
+         parameter vector to omega
+  */
+  std::vector< std::pair<size_t,size_t> > GetInteractionIndex() const;
+
   /**
   \brief Set Extinction vector 
   */
@@ -148,6 +272,53 @@ public:
       assert(u.size()==om.size());
       u = om;
   };
+
+  /**
+  \brief Set Extinction rate of species sp (1..nSpecies)
+  */
+  void SetExtinction(size_t sp, float val){
+      assert(sp>=1 && sp<=e.size());
+      e[sp-1] = val;
+  };
+
+  /**
+  \brief Set Inmigration rate of species sp (1..nSpecies)
+  */
+  void SetInmigration(size_t sp, float val){
+      assert(sp>=1 && sp<=u.size());
+      u[sp-1] = val;
+  };
+
+  /**
+  \brief Set the total size of the community
+  */
+  void SetCommunitySize(size_t comSize){
+      communitySize = comSize;
+  };
+
+  /**
+  \brief Multiply all the interaction coefficients by a factor
+  */
+  void ScaleOmega(float factor){
+      omega.Scale(factor);
+      compiled.reset();
+  };
+
+  size_t GetNumberOfSpecies() const { return nSpecies; }
+
+  /**
+  \brief Names of the species from 0 (empty space), empty if the model file
+         has no names line
+  */
+  const std::vector<std::string> &GetSpeciesNames() const { return names; }
+
+  size_t GetCommunitySize() const { return communitySize; }
+
+  /**
+  \brief 64 bit FNV-1a hash of the model parameters, identifies the model
+         that produced an output file
+  */
+  uint64_t Hash() const;
   
   /**
   \brief Set Initial value of species' populations  
@@ -159,12 +330,84 @@ public:
 //  };
   
  
+  /**
+  \brief Read the model from a text file (dense or edge list) or from a
+         binary model file written by WriteBinaryModel()
+  */
   void  ReadModelParams(const std::string &fName);
 
+  /**
+  \brief Read the model from the cache file if it was compiled from the same
+         contents of fName, otherwise read fName and write the cache
+
+  The cache is a binary model file with the compiled model, tagged with a
+  hash of the contents of fName. It is replaced atomically, so runs that
+  share it can start at the same time.
+
+  \return true if the cache was used
+  */
+  bool ReadModelParamsCached(const std::string &fName, const std::string &cacheName);
+
+  /**
+  \brief Write the model and its compiled form in binary, the file is memory
+         mapped when it is read and both are used without copying them
+
+  \param sourceHash hash of the file the model was read from, for the cache
+  */
+  void WriteBinaryModel(const std::string &fName, uint64_t sourceHash=0) const;
+
+  /**
+  \brief Channels of the interactions used by the simulation, the ones read
+         with the model or compiled now if omega was changed
+  */
+  std::shared_ptr<const CompiledModel> GetCompiled() const {
+      if (compiled)
+          return compiled;
+      return std::make_shared<CompiledModel>(omega);
+  }
+
+  /**
+  \brief Keep the compiled model, so the simulations of a model shared by
+         several threads don't compile it each time
+  */
+  void Compile() {
+      if (!compiled)
+          compiled = std::make_shared<CompiledModel>(omega);
+  }
+
+  /**
+  \brief Groups of species that interact only through the empty space, see
+         ModelComponents
+  */
+  ModelComponents Components() const { return FindComponents(*GetCompiled()); }
+
+  /**
+  \brief Replace the model with a random food web: the niche model of
+         Williams and Martinez, the cascade model of Cohen and Newman, an
+         Erdős–Rényi random digraph with a fraction of basal species or a
+         cascade of predators with competition between basal species
+         (mixed).
+
+  Species are ordered by trophic rank, species that eat no other species are
+  basal and grow on the empty space (column 0). The same parameters and
+  seed give the same model.
+  */
+  void GenerateNetwork(const NetworkParameters &np);
+
   /**
   \brief Simulate the model using the Tau-leap method   
   */
-  void SimulTauLeap(const SimulationParameters & sp, matrix<size_t> & N );
+  void SimulTauLeap(const SimulationParameters & sp, matrix<size_t> & N ) const;
+
+  /**
+  \brief Simulate the model using the Tau-leap method, streaming each
+         evaluation to a sink
+
+  \param from checkpoint to continue from, the sink is resumed at its
+              output size instead of starting a new output
+  */
+  void SimulTauLeap(const SimulationParameters & sp, TrajectorySink & out,
+                    const Checkpoint *from = nullptr) const;
   
   friend std::ostream& operator<<(std::ostream&,  const SnimModel&);
 };
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   sparsematrix.h
+  \brief  Square matrix of float stored by rows with only the non-zero elements
+ */
+#ifndef SNIM_SPARSEMATRIX_HH_
+#define SNIM_SPARSEMATRIX_HH_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace snim {
+
+/**
+  \brief Compressed sparse rows: the columns and values of row r are the
+         elements rowStart[r] to rowStart[r+1]-1 of colIdx and vals, with
+         the columns in increasing order.
+
+  Memory is proportional to the number of elements stored, so interaction
+  matrices of tens of thousands of species fit when most of them are zero.
+  Elements set to zero after they were stored are kept as explicit zeros.
+
+  The arrays can also be a view of memory owned by someone else, a memory
+  mapped model file; the first change copies them.
+ */
+class SparseMatrix {
+    size_t n=0;
+    size_t nnz=0;
+    std::vector<uint64_t> rowStartV;    // Own storage, empty for a view
+    std::vector<uint32_t> colIdxV;
+    std::vector<float> valsV;
+    const uint64_t *rowStart=nullptr;
+    const uint32_t *colIdx=nullptr;
+    const float *vals=nullptr;
+    std::shared_ptr<const void> owner;  // Keeps the memory of a view
+
+    void Point() {
+        if (owner)
+            return;
+        rowStart = rowStartV.data();
+        colIdx = colIdxV.data();
+        vals = valsV.data();
+    }
+
+    void Own() {
+        if (!owner)
+            return;
+        rowStartV.assign(rowStart, rowStart + n + 1);
+        colIdxV.assign(colIdx, colIdx + nnz);
+        valsV.assign(vals, vals + nnz);
+        owner.reset();
+        Point();
+    }
+
+public:
+    struct Triplet {
+        uint32_t row;
+        uint32_t col;
+        float val;
+    };
+
+    SparseMatrix() : rowStartV(1, 0) { Point(); }
+
+    explicit SparseMatrix(size_t size) : n(size), rowStartV(size+1, 0) { Point(); }
+
+    SparseMatrix(const SparseMatrix &m) : n(m.n), nnz(m.nnz), rowStartV(m.rowStartV), colIdxV(m.colIdxV),
+        valsV(m.valsV), rowStart(m.rowStart), colIdx(m.colIdx), vals(m.vals), owner(m.owner) { Point(); }
+
+    SparseMatrix &operator=(SparseMatrix m) {
+        std::swap(n, m.n);
+        std::swap(nnz, m.nnz);
+        rowStartV.swap(m.rowStartV);
+        colIdxV.swap(m.colIdxV);
+        valsV.swap(m.valsV);
+        std::swap(rowStart, m.rowStart);
+        std::swap(colIdx, m.colIdx);
+        std::swap(vals, m.vals);
+        owner.swap(m.owner);
+        Point();
+        return *this;
+    }
+
+    /// Matrix that uses the arrays in place while owner is alive
+    ///
+    static SparseMatrix View(size_t size, size_t nonZeros, const uint64_t *rowStart, const uint32_t *colIdx,
+                             const float *vals, std::shared_ptr<const void> owner) {
+        SparseMatrix m;
+        m.n = size;
+        m.nnz = nonZeros;
+        m.rowStartV.clear();
+        m.owner = owner;
+        m.rowStart = rowStart;
+        m.colIdx = colIdx;
+        m.vals = vals;
+        return m;
+    }
+
+    /// Build from elements in any order, zeros are left out and when an
+    /// element is repeated the last one is used
+    ///
+    static SparseMatrix FromTriplets(size_t size, std::vector<Triplet> &t) {
+        std::stable_sort(t.begin(), t.end(), [](const Triplet &a, const Triplet &b){
+            return std::tie(a.row, a.col) < std::tie(b.row, b.col);
+        });
+
+        SparseMatrix m(size);
+        for (size_t i = 0; i < t.size(); ++i) {
+            if (t[i].row >= size || t[i].col >= size)
+                throw std::out_of_range("Element outside of the interaction matrix");
+            if (i + 1 < t.size() && t[i+1].row == t[i].row && t[i+1].col == t[i].col)
+                continue;
+            if (t[i].val == 0)
+                continue;
+            m.colIdxV.push_back(t[i].col);
+            m.valsV.push_back(t[i].val);
+            ++m.rowStartV[t[i].row + 1];
+        }
+        for (size_t r = 0; r < size; ++r)
+            m.rowStartV[r + 1] += m.rowStartV[r];
+        m.nnz = m.valsV.size();
+        m.Point();
+        return m;
+    }
+
+    /// Build from the arrays of the compressed rows, that are moved into the
+    /// matrix. Used by readers that produce the elements in row order, so no
+    /// triplets are kept.
+    ///
+    static SparseMatrix FromRows(size_t size, std::vector<uint64_t> &&rowStart, std::vector<uint32_t> &&cols,
+                                 std::vector<float> &&vals) {
+        if (rowStart.size() != size + 1 || rowStart[0] != 0 || rowStart[size] != cols.size() ||
+            cols.size() != vals.size())
+            throw std::invalid_argument("Inconsistent arrays of the interaction matrix");
+        for (size_t r = 0; r < size; ++r) {
+            if (rowStart[r + 1] < rowStart[r])
+                throw std::invalid_argument("Inconsistent arrays of the interaction matrix");
+            for (size_t i = rowStart[r]; i < rowStart[r + 1]; ++i)
+                if (cols[i] >= size || (i > rowStart[r] && cols[i] <= cols[i - 1]))
+                    throw std::invalid_argument("Columns of the interaction matrix out of order");
+        }
+
+        SparseMatrix m;
+        m.n = size;
+        m.nnz = vals.size();
+        m.rowStartV = std::move(rowStart);
+        m.colIdxV = std::move(cols);
+        m.valsV = std::move(vals);
+        m.Point();
+        return m;
+    }
+
+    size_t rows() const { return n; }
+    size_t cols() const { return n; }
+    size_t nonZeros() const { return nnz; }
+
+    /// Whether the arrays are a view of memory owned by someone else
+    ///
+    bool IsView() const { return static_cast<bool>(owner); }
+
+    /// The arrays, to write them to a file
+    ///
+    const uint64_t *RowStarts() const { return rowStart; }
+    const uint32_t *Cols() const { return colIdx; }
+    const float *Values() const { return vals; }
+
+    /// Elements of row r are RowBegin(r) to RowEnd(r)-1
+    ///
+    size_t RowBegin(size_t r) const { return rowStart[r]; }
+    size_t RowEnd(size_t r) const { return rowStart[r + 1]; }
+    uint32_t Col(size_t i) const { return colIdx[i]; }
+    float Value(size_t i) const { return vals[i]; }
+
+    float operator()(size_t r, size_t c) const {
+        auto b = colIdx + rowStart[r], e = colIdx + rowStart[r + 1];
+        auto it = std::lower_bound(b, e, c);
+        return (it != e && *it == c) ? vals[it - colIdx] : 0.0f;
+    }
+
+    /// Change an element, a new element is inserted in its row
+    ///
+    void Set(size_t r, size_t c, float v) {
+        if (r >= n || c >= n)
+            throw std::out_of_range("Element outside of the interaction matrix");
+        auto b = colIdx + rowStart[r], e = colIdx + rowStart[r + 1];
+        auto it = std::lower_bound(b, e, c);
+        size_t pos = it - colIdx;
+        if (it != e && *it == c) {
+            Own();
+            valsV[pos] = v;
+            return;
+        }
+        if (v == 0)
+            return;
+
+        Own();
+        colIdxV.insert(colIdxV.begin() + pos, static_cast<uint32_t>(c));
+        valsV.insert(valsV.begin() + pos, v);
+        for (size_t i = r + 1; i <= n; ++i)
+            ++rowStartV[i];
+        ++nnz;
+        Point();
+    }
+
+    void Scale(float factor) {
+        Own();
+        for (auto &v : valsV)
+            v *= factor;
+    }
+
+    /// The same matrix with rows and columns renumbered, row and column k of
+    /// the result are row and column order[k] of this one
+    ///
+    SparseMatrix Permuted(const std::vector<uint32_t> &order) const {
+        std::vector<uint32_t> inv(n);
+        for (size_t k = 0; k < n; ++k)
+            inv[order[k]] = k;
+        std::vector<Triplet> t;
+        t.reserve(nnz);
+        for (size_t k = 0; k < n; ++k)
+            for (size_t i = RowBegin(order[k]); i < RowEnd(order[k]); ++i)
+                t.push_back({uint32_t(k), inv[Col(i)], Value(i)});
+        return FromTriplets(n, t);
+    }
+};
+
+} /* end namespace */
+
+#endif
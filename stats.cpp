@@ -0,0 +1,207 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <ios>
+#include <sstream>
+#include <stdexcept>
+#include "stats.h"
+
+namespace snim {
+
+SummaryStats CalcSummaryStats(const matrix<size_t> &N, size_t fromTime, size_t communitySize){
+    SummaryStats st;
+    if (N.cols() == 0 || fromTime >= N.cols())
+        return st;
+
+    for (size_t s = 1; s < N.rows(); ++s) {
+        double sum = 0;
+        for (size_t c = fromTime; c < N.cols(); ++c)
+            sum += N(s,c);
+        double avg = sum / (N.cols() - fromTime);
+        if (avg > 0) {
+            double freq = avg / communitySize;
+            st.S += 1;
+            st.H -= freq * std::log(freq);
+        }
+    }
+    return st;
+}
+
+void StatsSink::Begin(const TrajectoryInfo &info){
+    nRows = info.nRows;
+    rowSpecies.resize(nRows);
+    emptyRow = nRows;
+    for (size_t r = 0; r < nRows; ++r) {
+        rowSpecies[r] = info.species.empty() ? r : info.species[r];
+        if (rowSpecies[r] == 0)
+            emptyRow = r;
+    }
+    firstEval = info.firstEval;
+    evalStride = info.evalStride;
+    communitySize = info.maxCount;
+    n = 0;
+    mean.assign(nRows, 0.0);
+    m2.assign(nRows, 0.0);
+    richness.clear();
+    shannon.clear();
+
+    size_t lastEval = firstEval + (info.nCols > 0 ? info.nCols - 1 : 0) * evalStride;
+    if (info.nCols > 0 && lastEval >= fromEval) {
+        size_t skip = fromEval > firstEval ? (fromEval - firstEval + evalStride - 1) / evalStride : 0;
+        richness.reserve(info.nCols - skip);
+        shannon.reserve(info.nCols - skip);
+    }
+}
+
+void StatsSink::Column(size_t col, const size_t *values){
+    size_t eval = firstEval + col * evalStride;
+    if (eval < fromEval)
+        return;
+
+    if (n++ == 0)
+        firstUsed = eval;
+    double S = 0, H = 0;
+    for (size_t r = 0; r < nRows; ++r) {
+        double x = values[r];
+        double d = x - mean[r];
+        mean[r] += d / n;
+        m2[r] += d * (x - mean[r]);
+
+        if (r != emptyRow && values[r] > 0) {
+            double freq = x / communitySize;
+            S += 1;
+            H -= freq * std::log(freq);
+        }
+    }
+    richness.push_back(S);
+    shannon.push_back(H);
+}
+
+SummaryStats StatsSink::Summary() const {
+    SummaryStats st;
+    for (size_t r = 0; r < nRows; ++r)
+        if (r != emptyRow && mean[r] > 0) {
+            double freq = mean[r] / communitySize;
+            st.S += 1;
+            st.H -= freq * std::log(freq);
+        }
+    return st;
+}
+
+void StatsSink::Write(std::ostream &os) const {
+    auto st = Summary();
+    os << "# Statistics of " << n << " evaluations from " << fromEval << "\n";
+    os << "# S = " << st.S << "\tH = " << st.H << "\n";
+    os << "species\tmean\tvariance\n";
+    for (size_t r = 0; r < nRows; ++r)
+        os << rowSpecies[r] << "\t" << mean[r] << "\t" << Variance(r) << "\n";
+
+    os << "\ntime\tS\tH\n";
+    for (size_t c = 0; c < richness.size(); ++c)
+        os << firstUsed + c * evalStride << "\t" << richness[c] << "\t" << shannon[c] << "\n";
+}
+
+void StatsSink::SaveState(std::ostream &os) const {
+    os << "# state\t" << n << "\t" << firstUsed << "\n" << std::hexfloat;
+    for (size_t r = 0; r < nRows; ++r)
+        os << "# " << mean[r] << "\t" << m2[r] << "\n";
+    for (size_t c = 0; c < richness.size(); ++c)
+        os << "# " << richness[c] << "\t" << shannon[c] << "\n";
+    os << std::defaultfloat;
+}
+
+/// Reads the pair of numbers of a state line, strtod parses the
+/// hexadecimal floating point that the streams can't
+///
+static bool ReadStateLine(std::istream &is, double &a, double &b){
+    std::string line;
+    if (!std::getline(is, line) || line.compare(0, 2, "# ") != 0)
+        return false;
+    const char *p = line.c_str() + 2;
+    char *end;
+    a = std::strtod(p, &end);
+    if (end == p)
+        return false;
+    p = end;
+    b = std::strtod(p, &end);
+    return end != p;
+}
+
+void StatsSink::LoadState(std::istream &is){
+    const std::string bad = "The statistics output does not match the checkpoint";
+    std::string line;
+    while (std::getline(is, line))
+        if (line.compare(0, 8, "# state\t") == 0)
+            break;
+    if (!is)
+        throw std::runtime_error(bad);
+
+    std::istringstream head(line.substr(8));
+    size_t count = 0, first = 0;
+    if (!(head >> count >> first))
+        throw std::runtime_error(bad);
+    for (size_t r = 0; r < nRows; ++r)
+        if (!ReadStateLine(is, mean[r], m2[r]))
+            throw std::runtime_error(bad);
+    richness.resize(count);
+    shannon.resize(count);
+    for (size_t c = 0; c < count; ++c)
+        if (!ReadStateLine(is, richness[c], shannon[c]))
+            throw std::runtime_error(bad);
+    n = count;
+    firstUsed = first;
+}
+
+void StatsFileSink::End(){
+    std::ofstream os(fName);
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+    Write(os);
+    if (!os)
+        throw std::runtime_error("Error writing output file " + fName);
+}
+
+/// The file is written again at every checkpoint
+///
+uint64_t StatsFileSink::Sync(){
+    std::ofstream os(fName, std::ios::binary);
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+    Write(os);
+    SaveState(os);
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Error writing output file " + fName);
+    return os.tellp();
+}
+
+void StatsFileSink::Resume(const TrajectoryInfo &info, size_t col, uint64_t size){
+    (void)col;
+    Begin(info);
+
+    std::ifstream is(fName, std::ios::binary | std::ios::ate);
+    if (!is)
+        throw std::runtime_error("Can't open output file " + fName);
+    if (static_cast<uint64_t>(is.tellg()) != size)
+        throw std::runtime_error("The statistics output does not match the checkpoint");
+    is.seekg(0);
+    LoadState(is);
+}
+
+} // end namespace
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   stats.h
+  \brief  Summary statistics of the trajectories calculated while simulating
+ */
+#ifndef SNIM_STATS_HH_
+#define SNIM_STATS_HH_
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "trajectory.h"
+
+namespace snim {
+
+/**
+  \brief Summary statistics of a simulation: richness and Shannon diversity
+ */
+struct SummaryStats {
+    double S=0.0;                       /// Number of species with mean density > 0
+    double H=0.0;                       /// Shannon diversity of the mean densities
+};
+
+/// Summary statistics of the mean densities from evaluation fromTime to the
+/// end, frequencies are relative to the community size (as in the R
+/// function snim_easyABC_omega)
+///
+SummaryStats CalcSummaryStats(const matrix<size_t> &N, size_t fromTime, size_t communitySize);
+
+/**
+  \brief Accumulates statistics of the trajectory instead of storing it.
+
+  From evaluation fromEval on it keeps the running mean and variance of each
+  species (Welford) and the richness and Shannon diversity of each column,
+  so memory does not depend on the number of species times evaluations.
+  Frequencies are relative to the community size given by Begin().
+ */
+class StatsSink : public TrajectorySink {
+    size_t fromEval;
+    size_t nRows=0;
+    size_t firstEval=0;                 // Evaluation of column 0
+    size_t evalStride=1;                // Evaluations between columns
+    size_t firstUsed=0;                 // Evaluation of the first column accumulated
+    std::vector<size_t> rowSpecies;     // Species of each row
+    size_t emptyRow=0;                  // Row of the empty space, nRows if it is not recorded
+    double communitySize=0;
+    size_t n=0;                         // Columns accumulated
+    std::vector<double> mean, m2;
+    std::vector<double> richness, shannon;
+
+public:
+    /// \param from first evaluation used, 0 are the initial conditions
+    ///
+    explicit StatsSink(size_t from=0) : fromEval(from) {}
+
+    void Begin(const TrajectoryInfo &info) override;
+    void Column(size_t col, const size_t *values) override;
+
+    /// Number of columns accumulated
+    ///
+    size_t Count() const { return n; }
+
+    /// Species of row r, the rows are the species recorded
+    ///
+    size_t Species(size_t r) const { return rowSpecies[r]; }
+
+    /// Mean density of row r, by default row 0 is the empty space
+    ///
+    double Mean(size_t r) const { return mean[r]; }
+
+    /// Sample variance of the density of row r
+    ///
+    double Variance(size_t r) const { return n > 1 ? m2[r] / (n - 1) : 0.0; }
+
+    /// Richness and Shannon diversity of each column accumulated, the
+    /// first one is evaluation FirstEval() and the rest follow every
+    /// recordStride evaluations
+    ///
+    size_t FirstEval() const { return firstUsed; }
+    const std::vector<double> &Richness() const { return richness; }
+    const std::vector<double> &Shannon() const { return shannon; }
+
+    /// Richness and Shannon diversity of the mean densities, the same as
+    /// CalcSummaryStats() of the whole trajectory
+    ///
+    SummaryStats Summary() const;
+
+    /// Write the statistics as tab separated text: comment lines with the
+    /// summary, a table with the mean and variance of each species and a
+    /// table with the richness and Shannon diversity of each evaluation
+    ///
+    void Write(std::ostream &os) const;
+
+protected:
+    /// Write the accumulators as comment lines, in hexadecimal floating point
+    /// so LoadState() restores them exactly
+    ///
+    void SaveState(std::ostream &os) const;
+
+    /// Restore the accumulators saved by SaveState(), after Begin()
+    ///
+    void LoadState(std::istream &is);
+};
+
+/**
+  \brief StatsSink that writes its statistics to a file at the end
+
+  At each checkpoint the file gets the statistics so far followed by the
+  state of the accumulators, that Resume() reads to continue them.
+ */
+class StatsFileSink : public StatsSink {
+    std::string fName;
+
+public:
+    StatsFileSink(const std::string &name, size_t from) : StatsSink(from), fName(name) {}
+
+    void End() override;
+    uint64_t Sync() override;
+    void Resume(const TrajectoryInfo &info, size_t col, uint64_t size) override;
+};
+
+} /* end namespace */
+
+#endif
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include "sweep.h"
+#include "threadpool.h"
+#include "tsvwriter.h"
+#include "configfile.h"
+
+namespace snim {
+
+/// Read a sweep specification, every key that is not a general option is an axis
+///
+SweepSpec::SweepSpec(const std::string &fName){
+
+    ConfigFile cfg(fName);
+    modelFile  = cfg.getValueOfKey<std::string>("model");
+    simFile    = cfg.getValueOfKey<std::string>("simulation");
+    outPrefix  = cfg.getValueOfKey<std::string>("output", "sweep");
+    nThreads   = cfg.getValueOfKey<size_t>("threads", 0);
+    replicates = cfg.getValueOfKey<size_t>("replicates", 1);
+    pinThreads = cfg.getValueOfKey<int>("pinThreads", 0) != 0;
+
+    if (simFile.empty())
+        throw std::invalid_argument("Sweep specification [" + fName + "] needs a simulation file");
+
+    for (auto const &key : cfg.getKeys()) {
+        if (key == "model" || key == "simulation" || key == "output" ||
+            key == "threads" || key == "replicates" || key == "pinThreads")
+            continue;
+        AddAxis(key, cfg.getValueOfKey<std::string>(key));
+    }
+}
+
+/// Parse the levels of an axis, iniCond levels are separated by ';' the
+/// other axes are scalars separated by spaces
+///
+/// \param key name of the parameter, e[i] and u[i] for species i
+/// \param values string with the levels
+///
+void SweepSpec::AddAxis(const std::string &key, const std::string &values){
+    SweepAxis ax;
+    ax.name = key;
+
+    auto bracket = key.find('[');
+    std::string base = key.substr(0, bracket);
+    if (bracket != key.npos) {
+        std::istringstream idx(key.substr(bracket + 1));
+        char comma = 0;
+        if (!(idx >> ax.species))
+            throw std::invalid_argument("Sweep: bad species index in [" + key + "]");
+        bool element = base == "omega" || base == "omegaScale";
+        if (element && !(idx >> comma >> ax.col && comma == ','))
+            throw std::invalid_argument("Sweep: " + base + " needs row and column as " + base + "[i,j] in [" + key + "]");
+        if (!element && ax.species == 0)
+            throw std::invalid_argument("Sweep: bad species index in [" + key + "]");
+    }
+
+    if (base == "omegaScale")         ax.kind = bracket == key.npos ? SweepAxis::OmegaScale : SweepAxis::OmegaFactor;
+    else if (base == "e")             ax.kind = SweepAxis::Extinction;
+    else if (base == "u")             ax.kind = SweepAxis::Immigration;
+    else if (base == "communitySize") ax.kind = SweepAxis::CommunitySize;
+    else if (base == "tau")           ax.kind = SweepAxis::Tau;
+    else if (base == "iniCond")       ax.kind = SweepAxis::IniCond;
+    else if (base == "omega")         ax.kind = SweepAxis::Omega;
+    else if (base == "nEvals")        ax.kind = SweepAxis::NEvals;
+    else
+        throw std::invalid_argument("Sweep: unknown parameter [" + key + "]");
+
+    if ((ax.kind == SweepAxis::Extinction || ax.kind == SweepAxis::Immigration) && ax.species == 0)
+        throw std::invalid_argument("Sweep: species index needed in [" + key + "]");
+    if (ax.kind == SweepAxis::Omega && bracket == key.npos)
+        throw std::invalid_argument("Sweep: omega needs row and column as omega[i,j] in [" + key + "]");
+
+    if (ax.kind == SweepAxis::IniCond) {
+        std::istringstream levels(values);
+        std::string level;
+        while (std::getline(levels, level, ';')) {
+            std::istringstream strline(level);
+            std::vector<double> v;
+            double tempd=0;
+            while (strline >> tempd)
+                v.push_back(tempd);
+            if (!v.empty())
+                ax.levels.push_back(v);
+        }
+    }
+    else {
+        std::istringstream strline(values);
+        double tempd=0;
+        while (strline >> tempd)
+            ax.levels.push_back(std::vector<double>(1, tempd));
+    }
+
+    if (ax.levels.empty())
+        throw std::invalid_argument("Sweep: no levels for [" + key + "]");
+
+    axes.push_back(ax);
+}
+
+void SweepSpec::AddOverride(const std::string &keyValue){
+    auto eq = keyValue.find('=');
+    if (eq == keyValue.npos)
+        throw std::invalid_argument("Override [" + keyValue + "] is not key=value");
+    std::string key = keyValue.substr(0, eq);
+    key.erase(key.find_last_not_of(" \t") + 1);
+    AddAxis(key, keyValue.substr(eq + 1));
+    if (axes.back().levels.size() != 1)
+        throw std::invalid_argument("Override [" + keyValue + "] has more than one value");
+}
+
+size_t SweepSpec::JobCount() const {
+    size_t n = replicates;
+    for (auto const &ax : axes)
+        n *= ax.levels.size();
+    return n;
+}
+
+/// Jobs are numbered with the replicate varying fastest and then the axes
+/// in order, the first axis is the least significant digit
+///
+std::vector<size_t> SweepSpec::JobLevels(size_t job) const {
+    std::vector<size_t> lv(axes.size());
+    size_t point = job / replicates;
+    for (size_t a = 0; a < axes.size(); ++a) {
+        lv[a] = point % axes[a].levels.size();
+        point /= axes[a].levels.size();
+    }
+    return lv;
+}
+
+void SweepSpec::ApplyJob(size_t job, SnimModel &mdl, SimulationParameters &sp) const {
+    auto lv = JobLevels(job);
+    for (size_t a = 0; a < axes.size(); ++a) {
+        auto const &ax = axes[a];
+        auto const &val = ax.levels[lv[a]];
+        if (ax.species > mdl.GetNumberOfSpecies() || ax.col > mdl.GetNumberOfSpecies())
+            throw std::invalid_argument("Sweep: species out of range in [" + ax.name + "]");
+
+        switch (ax.kind) {
+            case SweepAxis::OmegaScale:
+                mdl.ScaleOmega(val[0]);
+                break;
+            case SweepAxis::Extinction:
+                mdl.SetExtinction(ax.species, val[0]);
+                break;
+            case SweepAxis::Immigration:
+                mdl.SetInmigration(ax.species, val[0]);
+                break;
+            case SweepAxis::CommunitySize:
+                mdl.SetCommunitySize(val[0]);
+                break;
+            case SweepAxis::Tau:
+                sp.tau = val[0];
+                break;
+            case SweepAxis::IniCond:
+                sp.iniCond.assign(val.begin(), val.end());
+                break;
+            case SweepAxis::Omega:
+                mdl.SetOmega(ax.species, ax.col, val[0]);
+                break;
+            case SweepAxis::NEvals:
+                sp.nEvals = val[0];
+                break;
+            case SweepAxis::OmegaFactor:
+                mdl.SetOmega(ax.species, ax.col, mdl.GetOmega(ax.species, ax.col) * val[0]);
+                break;
+        }
+    }
+}
+
+/**
+  \brief Keeps one job in the matrix of its worker and gives it as a tab
+         separated block to append when the simulation ends
+ */
+class SweepBlockSink : public MatrixSink {
+    const matrix<size_t> &N;
+    std::function<void(const std::string &)> append;
+
+public:
+    SweepBlockSink(matrix<size_t> &out, std::function<void(const std::string &)> fn) :
+        MatrixSink(out), N(out), append(std::move(fn)) {}
+
+    void End() override {
+        std::ostringstream text;
+        WriteTsv(text, N);
+        append(text.str());
+    }
+};
+
+/// Run the sweep on a thread pool. All trajectories go to one file
+/// <output>.out in the same tab separated layout of a single run, the index
+/// <output>.idx has one line per job with its levels, seed and the byte range
+/// of its block in the .out file. Blocks are written in completion order.
+///
+void RunSweep(const SweepSpec &spec){
+    using namespace std;
+
+    SimulationParameters baseSp(spec.simFile);
+
+    // Jobs are kept in memory and run in parallel, all of them would save
+    // to the same checkpoint file
+    baseSp.checkpointEvery = 0;
+
+    // With a network in the simulation file replicate r simulates the food
+    // web generated with networkSeed + r, the same for every point of the grid
+    //
+    NetworkParameters np(spec.simFile);
+    SnimModel base;
+    if (np.Active()) {
+        if (np.seed == 0) {
+            std::random_device rd{};
+            np.seed = rd();
+        }
+        base.GenerateNetwork(np);
+    }
+    else if (spec.modelFile.empty())
+        throw std::invalid_argument("Sweep: no model file and no network in the simulation file");
+    else if (baseSp.modelCache)
+        base.ReadModelParamsCached(spec.modelFile, spec.modelFile + ".snc");
+    else
+        base.ReadModelParams(spec.modelFile);
+    base.Compile();                     // Shared by the jobs, that patch their copies
+
+    // Each job gets its own seed, derived from the base seed so the sweep can
+    // be repeated
+    //
+    size_t baseSeed = baseSp.rndSeed;
+    if (baseSeed == 0) {
+        std::random_device rd{};
+        baseSeed = rd();
+    }
+
+    ofstream fout(spec.outPrefix + ".out", ios::binary);
+    if (!fout)
+        throw std::runtime_error("Sweep: can't open output file " + spec.outPrefix + ".out");
+
+    size_t nJobs = spec.JobCount();
+    vector<streamoff> offset(nJobs), length(nJobs);
+    mutex outMtx;
+
+    // Output buffers are allocated by their worker, so with pinned threads
+    // they are first touched in the worker's NUMA node
+    //
+    ThreadPool pool(spec.nThreads, spec.pinThreads);
+    vector< matrix<size_t> > out(pool.size());
+    pool.RunOnEach([&](size_t w){
+        size_t rows = baseSp.recordSpecies.empty() ? base.GetNumberOfSpecies()+1 : baseSp.recordSpecies.size();
+        out[w] = matrix<size_t>(rows, baseSp.RecordedEvals(), size_t(0));
+    });
+
+    pool.Run(nJobs, [&](size_t job, size_t w){
+        SnimModel mdl(base);
+        if (np.Active() && job % spec.replicates > 0) {
+            NetworkParameters rep(np);
+            rep.seed = np.seed + job % spec.replicates;
+            mdl.GenerateNetwork(rep);
+        }
+        SimulationParameters sp(baseSp);
+        spec.ApplyJob(job, mdl, sp);
+        sp.rndSeed = baseSeed + job;
+
+        // The columns are stored by the writer thread of the AsyncSink while
+        // the worker simulates, only the write of the block is serialized
+        AsyncSink sink(unique_ptr<TrajectorySink>(new SweepBlockSink(out[w], [&](const string &block){
+            lock_guard<mutex> lock(outMtx);
+            offset[job] = fout.tellp();
+            fout.write(block.data(), block.size());
+            length[job] = block.size();
+        })));
+        mdl.SimulTauLeap(sp, sink);
+    });
+
+    ofstream fidx(spec.outPrefix + ".idx");
+    fidx << "job\treplicate";
+    for (auto const &ax : spec.axes)
+        fidx << "\t" << ax.name;
+    if (np.Active())
+        fidx << "\tnetworkSeed";
+    fidx << "\tseed\toffset\tbytes\n";
+
+    for (size_t job = 0; job < nJobs; ++job) {
+        fidx << job << "\t" << job % spec.replicates;
+        auto lv = spec.JobLevels(job);
+        for (size_t a = 0; a < spec.axes.size(); ++a) {
+            auto const &val = spec.axes[a].levels[lv[a]];
+            fidx << "\t" << val[0];
+            for (size_t i = 1; i < val.size(); ++i)
+                fidx << " " << val[i];
+        }
+        if (np.Active())
+            fidx << "\t" << np.seed + job % spec.replicates;
+        fidx << "\t" << baseSeed + job << "\t" << offset[job] << "\t" << length[job] << "\n";
+    }
+
+    if (spec.pinThreads)
+        pool.Report(cout);
+}
+
+} // end namespace
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   sweep.h
+  \brief  Parameter sweeps over a grid of model and simulation parameters
+ */
+#ifndef SNIM_SWEEP_HH_
+#define SNIM_SWEEP_HH_
+
+#include <string>
+#include <vector>
+
+#include "snim.h"
+
+namespace snim {
+
+/**
+  \brief One parameter that is varied in a sweep with all its levels
+ */
+struct SweepAxis {
+    enum Kind { OmegaScale, Extinction, Immigration, CommunitySize, Tau, IniCond, Omega, NEvals, OmegaFactor };
+
+    Kind kind;
+    std::string name;                           /// Key as written in the specification
+    size_t species=0;                           /// Species (1..nSpecies) for e[i] and u[i], row of omega[i,j]
+    size_t col=0;                               /// Column of omega[i,j] and omegaScale[i,j]
+    std::vector< std::vector<double> > levels;  /// Values of each level, only iniCond could have more than one
+};
+
+/**
+  \brief Specification of a sweep read from a configuration file
+
+  File structure, name = value # comment:
+
+      model         = model.par          # Base model parameters, not needed with a network
+      simulation    = simulationpar.cfg  # Base simulation parameters
+      output        = sweep              # Writes sweep.idx and sweep.out
+      threads       = 0                  # 0 means all the cores
+      pinThreads    = 0                  # 1 pins workers to CPUs, NUMA local buffers
+      replicates    = 1                  # Runs of each point of the grid
+      omegaScale    = 0.5 1 2            # Factors that multiply omega
+      e[2]          = 0.5 1              # Extinction rate of species 2
+      u[1]          = 0.01 0.1           # Immigration rate of species 1
+      omega[2,3]    = 0 0.5 1            # One interaction coefficient, rows and columns from 0
+      omegaScale[2,3] = 0.5 2            # Factors that multiply one coefficient of the base model
+      nEvals        = 100 1000
+      communitySize = 10000 20000
+      tau           = 0.01 0.005
+      iniCond       = 1000 ; 500 2000 10 # Levels separated by ';'
+
+  The grid is the cartesian product of the levels of all the axes present.
+  When the simulation file has a network (see NetworkParameters) replicate r
+  of every point simulates the food web generated with networkSeed + r.
+ */
+class SweepSpec {
+public:
+    std::string modelFile;
+    std::string simFile;
+    std::string outPrefix="sweep";
+    size_t nThreads=0;
+    size_t replicates=1;
+    bool pinThreads=false;
+    std::vector<SweepAxis> axes;
+
+    SweepSpec() {}
+
+    /// Read the sweep specification from file
+    ///
+    SweepSpec(const std::string &fName);
+
+    /// Add an axis given its key and the string with its levels
+    ///
+    void AddAxis(const std::string &key, const std::string &values);
+
+    /// Add an axis with a single level from key=value, the format of the
+    /// --set option and of the manifest overrides
+    ///
+    void AddOverride(const std::string &keyValue);
+
+    /// Number of points of the grid times the number of replicates
+    ///
+    size_t JobCount() const;
+
+    /// Level of each axis used by a job
+    ///
+    std::vector<size_t> JobLevels(size_t job) const;
+
+    /// Apply the levels of a job to copies of the base model and parameters
+    ///
+    void ApplyJob(size_t job, SnimModel &mdl, SimulationParameters &sp) const;
+};
+
+/// Run all the jobs of a sweep and write the result store
+///
+void RunSweep(const SweepSpec &spec);
+
+} /* end namespace */
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include "abc.h"
+
+TEST(snimAbc, SummaryStats){
+    using namespace snim;
+
+    matrix <size_t> N(4,3, {9000, 500, 500, 0,
+                            9000, 700, 300, 0,
+                            9000, 600, 400, 0});
+
+    auto st = CalcSummaryStats(N, 1, 10000);
+    EXPECT_EQ(2, st.S);
+    EXPECT_NEAR(-(0.065*std::log(0.065) + 0.035*std::log(0.035)), st.H, 1e-12);
+}
+
+TEST(snimAbc, RejectionAndSmc){
+    using namespace snim;
+
+    std::cout << "2 species 1 Predator 1 prey, estimate predation and prey growth" << std::endl;
+    SnimModel mdl(2,10000);
+    mdl.SetOmega( {0.0, 0.0, 0.0,
+                   0.0, 0.0, 2.0,
+                   2.0, 0.0, 0.0} );
+    mdl.SetExtinction({1.0,1.0});
+    mdl.SetInmigration({0.01,0.01});
+
+    SimulationParameters sp = {0,10,0.05, 1000};
+
+    AbcParameters ap;
+    ap.nThreads = 2;
+    ap.nParticles = 20;
+    ap.priorMin = 0.0;
+    ap.priorMax = 4.0;
+    ap.useS = true;
+    ap.observed.S = 2;
+    ap.fromTime = 5;
+    ap.tolerance = {0.5};
+    ap.rndSeed = 1234;
+
+    AbcEngine rej(mdl, sp, ap);
+    EXPECT_EQ(1, rej.size());
+    auto pop = rej.Run();
+    ASSERT_EQ(20, pop.size());
+    for (auto const &p : pop) {
+        EXPECT_EQ(2, p.stats.S);
+        EXPECT_GE(p.theta[0], 0.0);
+        EXPECT_LE(p.theta[0], 4.0);
+    }
+
+    // Same seed with other number of threads gives the same particles
+    ap.nThreads = 3;
+    AbcEngine rej3(mdl, sp, ap);
+    auto pop3 = rej3.Run();
+    ASSERT_EQ(pop.size(), pop3.size());
+    for (size_t i = 0; i < pop.size(); ++i)
+        EXPECT_EQ(pop[i].theta[0], pop3[i].theta[0]);
+
+    ap.smc = true;
+    ap.tolerance = {1.0, 0.5};
+    AbcEngine smc(mdl, sp, ap);
+    pop = smc.Run();
+    ASSERT_EQ(20, pop.size());
+    double sumW = 0;
+    for (auto const &p : pop)
+        sumW += p.weight;
+    EXPECT_NEAR(1.0, sumW, 1e-9);
+}
+
+TEST(snimAbc, WorkersKeepCompiledModel){
+    using namespace snim;
+
+    SnimModel base(2,10000);
+    base.SetOmega( {0.0, 0.0, 0.0,
+                    0.0, 0.0, 2.0,
+                    2.0, 0.0, 0.0} );
+    base.SetExtinction({0.1,0.1});
+    base.SetInmigration({0.01,0.01});
+    base.Compile();
+
+    // A worker copy patches its own compiled model for each proposal
+    SnimModel worker(base);
+    worker.Compile();
+    for (double theta : {1.5, 3.0, 0.5}) {
+        worker.SetOmega(1, 2, theta);
+        worker.Compile();
+        auto cm = worker.GetCompiled();
+        EXPECT_EQ(cm.get(), worker.GetCompiled().get());
+        EXPECT_NE(base.GetCompiled().get(), cm.get());
+        EXPECT_FLOAT_EQ(theta, (*cm)[cm->Find(1,2)].net);
+    }
+
+    // A proposal that removes a channel compiles the copy once more
+    worker.SetOmega(1, 2, 0.0);
+    worker.Compile();
+    auto cm = worker.GetCompiled();
+    EXPECT_EQ(cm.get(), worker.GetCompiled().get());
+    EXPECT_EQ(cm->Channels(), cm->Find(1,2));
+    EXPECT_FLOAT_EQ(2.0, (*base.GetCompiled())[base.GetCompiled()->Find(1,2)].net);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "batch.h"
+#include "tsvwriter.h"
+
+TEST(snimBatch, SameAsSingleRuns){
+    using namespace snim;
+
+    {
+        std::ofstream os("testBatch.par");
+        os << "3 10000\n0.1 0.1 0.1\n1 1 1\n"
+              "0.0 0.0 0.0 0.0\n"
+              "0.0 0.0 3.0 2.0\n"
+              "4.0 0.0 0.0 0.0\n"
+              "2.0 0.0 0.5 0.0\n";
+        std::ofstream cs("testBatch.cfg");
+        cs << "rndSeed = 77\nnEvals = 30\ntau = 0.01\niniCond = 1000\noutputFormat = tsv\n";
+        std::ofstream bs("testBatchBad.cfg");
+        bs << "rndSeed = 77\nnEvals = 30\ntau 0.01\niniCond = 1000\n";
+        std::ofstream ms("testBatch.tsv");
+        ms << "# model\tsimulation\toutput\toverrides\n"
+              "testBatch.par\ttestBatch.cfg\ttestBatch1.out\n"
+              "\n"
+              "testBatch.par\ttestBatch.cfg\ttestBatch2.out\te[2]=0.5\ttau=0.02\n"
+              "missing.par\ttestBatch.cfg\ttestBatch3.out\n"
+              "testBatch.par\ttestBatchBad.cfg\ttestBatch4.out\n";
+    }
+
+    auto jobs = ReadManifest("testBatch.tsv");
+    ASSERT_EQ(4, jobs.size());
+    EXPECT_EQ(4, jobs[1].line);
+    ASSERT_EQ(2, jobs[1].overrides.size());
+    EXPECT_EQ("tau=0.02", jobs[1].overrides[1]);
+
+    auto status = RunBatch(jobs, 2);
+    EXPECT_TRUE(status[0].ok);
+    EXPECT_TRUE(status[1].ok);
+    EXPECT_FALSE(status[2].ok);
+    EXPECT_NE(std::string::npos, status[2].message.find("missing.par"));
+
+    // Errors of the configuration file fail only their job
+    EXPECT_FALSE(status[3].ok);
+    EXPECT_NE(std::string::npos, status[3].message.find("testBatchBad.cfg"));
+
+    // The same trajectories as the single runs
+    SnimModel mdl;
+    mdl.ReadModelParams("testBatch.par");
+    SimulationParameters sp("testBatch.cfg");
+    for (int j = 0; j < 2; ++j) {
+        SnimModel m(mdl);
+        SimulationParameters p(sp);
+        if (j == 1) {
+            m.SetExtinction(2, 0.5);
+            p.tau = 0.02;
+        }
+        matrix<size_t> out;
+        m.SimulTauLeap(p, out);
+        std::ostringstream expected;
+        WriteTsv(expected, out);
+
+        std::ifstream is(jobs[j].outFile);
+        std::stringstream actual;
+        actual << is.rdbuf();
+        EXPECT_EQ(expected.str(), actual.str()) << "job " << j;
+    }
+
+    WriteBatchStatus("testBatch.tsv.status", jobs, status);
+    std::ifstream st("testBatch.tsv.status");
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(st, line))
+        ++lines;
+    EXPECT_EQ(5, lines);
+
+    for (auto f : {"testBatch.par", "testBatch.cfg", "testBatchBad.cfg", "testBatch.tsv", "testBatch.tsv.status",
+                   "testBatch1.out", "testBatch2.out", "testBatch3.out", "testBatch4.out"})
+        std::remove(f);
+}
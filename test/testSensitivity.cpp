@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "sensitivity.h"
+
+TEST(snimGsa, SobolAndMorris){
+    using namespace snim;
+
+    std::cout << "1 species, abundance depends on growth and extinction, not on immigration" << std::endl;
+    SnimModel mdl(1,10000);
+    mdl.SetOmega( {0.0, 0.0,
+                   2.0, 0.0} );
+    mdl.SetExtinction({1.0});
+    mdl.SetInmigration({0.0});
+
+    SimulationParameters sp = {0,10,0.05, 1000};
+
+    GsaParameters gp;
+    gp.nThreads = 2;
+    gp.samples = 40;
+    gp.fromTime = 5;
+    gp.rndSeed = 1234;
+    gp.AddFactor("omega[1,0]", "2 4");
+    gp.AddFactor("u[1]", "0 0.00001");
+
+    EXPECT_THROW(gp.AddFactor("omega[1]", "0 1"), std::invalid_argument);
+    EXPECT_THROW(gp.AddFactor("e[1]", "1 0"), std::invalid_argument);
+
+    auto res = RunGsa(mdl, sp, gp);
+    ASSERT_EQ(3, res.size());
+    EXPECT_EQ("N1", res[2].output);
+    EXPECT_GT(res[2].variance, 0);
+    EXPECT_GT(res[2].first[0], 0.5);
+    EXPECT_GT(res[2].total[0], res[2].total[1]);
+
+    gp.morris = true;
+    gp.samples = 10;
+    res = RunGsa(mdl, sp, gp);
+    EXPECT_GT(res[2].first[0], res[2].first[1]);
+    EXPECT_GT(res[2].mu[0], 0);
+}
@@ -15,7 +15,11 @@
  */
 
 #include <gtest/gtest.h>
+#include <cmath>
+#include <iomanip>
+#include <random>
 #include "snim.h"
+#include "textscan.h"
 
 TEST(snimTauLeap, Initial0_Final0){
     using namespace snim;
@@ -314,4 +318,510 @@ TEST(snimTauLeap, Initial4000_Im001_Ext11_Pred300_Prey4000){
     EXPECT_NEAR(out(1,100),300,100);
     EXPECT_NEAR(out(2,100),4000,500);
        
-}
\ No newline at end of file
+}
+TEST(snimModel, SparseOmega){
+    using namespace snim;
+
+    SparseMatrix m(4);
+    m.Set(2, 3, 1.5);
+    m.Set(2, 0, 0.5);
+    m.Set(1, 1, 2.0);
+    m.Set(3, 3, 0.0);
+    EXPECT_EQ(3, m.nonZeros());
+    EXPECT_EQ(0.5, m(2,0));
+    EXPECT_EQ(1.5, m(2,3));
+    EXPECT_EQ(0.0, m(2,2));
+    EXPECT_EQ(0, m.Col(m.RowBegin(2)));
+    m.Set(2, 3, 0.0);
+    EXPECT_EQ(0.0, m(2,3));
+
+    std::vector<SparseMatrix::Triplet> t = {{1,2,1.0f}, {0,1,3.0f}, {1,2,4.0f}, {3,0,0.0f}};
+    auto f = SparseMatrix::FromTriplets(4, t);
+    EXPECT_EQ(2, f.nonZeros());
+    EXPECT_EQ(4.0, f(1,2));
+    EXPECT_EQ(3.0, f(0,1));
+}
+
+TEST(snimModel, EdgeListSameAsDense){
+    using namespace snim;
+
+    std::string denseName = "testSnim_dense.par", edgeName = "testSnim_edges.par";
+    {
+        std::ofstream os(denseName);
+        os << "3 10000\n0.1 0.1 0.1\n1 1 1\n"
+              "0.0 0.0 0.0 0.0\n"
+              "0.0 0.0 3.0 2.0\n"
+              "4.0 0.0 0.0 0.0\n"
+              "2.0 0.0 0.5 0.0\n";
+        std::ofstream es(edgeName);
+        es << "3 10000 edges\n0.1 0.1 0.1\n1 1 1\n"
+              "# row col omega\n"
+              "3 2 0.5\n"
+              "1 2 3\n"
+              "1 3 2\n"
+              "2 0 4\n"
+              "3 0 2\n";
+    }
+    SnimModel dense, edges;
+    dense.ReadModelParams(denseName);
+    edges.ReadModelParams(edgeName);
+    EXPECT_EQ(dense.Hash(), edges.Hash());
+    EXPECT_EQ(0.5, edges.GetOmega(3,2));
+    EXPECT_EQ(0.0, edges.GetOmega(2,3));
+
+    SimulationParameters sp = {77,50,0.01, 1000};
+    matrix<size_t> a, b;
+    dense.SimulTauLeap(sp, a);
+    edges.SimulTauLeap(sp, b);
+    EXPECT_TRUE(a == b);
+
+    {
+        std::ofstream es(edgeName);
+        es << "3 10000 edges\n0.1 0.1 0.1\n1 1 1\n4 1 0.5\n";
+    }
+    SnimModel wrong;
+    EXPECT_THROW(wrong.ReadModelParams(edgeName), std::invalid_argument);
+    std::remove(denseName.c_str());
+    std::remove(edgeName.c_str());
+}
+
+TEST(snimModel, BinaryModelFile){
+    using namespace snim;
+
+    std::string textName = "testSnim_text.par", binName = "testSnim_model.snm";
+    {
+        std::ofstream os(textName);
+        os << "3 10000\n0.1 0.2 0.3\n1 2 3\n"
+              "names Predator Prey1 Prey2\n"
+              "0.0 0.0 0.0 0.0\n"
+              "0.0 0.0 3.0 2.0\n"
+              "4.0 0.0 0.0 0.0\n"
+              "2.0 0.0 0.5 0.0\n";
+    }
+    SnimModel text;
+    text.ReadModelParams(textName);
+    text.WriteBinaryModel(binName);
+    EXPECT_FALSE(IsBinaryModel(textName));
+    EXPECT_TRUE(IsBinaryModel(binName));
+
+    SnimModel bin;
+    bin.ReadModelParams(binName);
+    EXPECT_EQ(text.Hash(), bin.Hash());
+    EXPECT_EQ(3, bin.GetNumberOfSpecies());
+    EXPECT_EQ(10000, bin.GetCommunitySize());
+    ASSERT_EQ(4, bin.GetSpeciesNames().size());
+    EXPECT_EQ("Prey1", bin.GetSpeciesNames()[2]);
+
+    SimulationParameters sp = {77,50,0.01, 1000};
+    matrix<size_t> a, b;
+    text.SimulTauLeap(sp, a);
+    bin.SimulTauLeap(sp, b);
+    EXPECT_TRUE(a == b);
+
+    // Copies share the mapped file until they are changed
+    SnimModel copy(bin);
+    copy.SetOmega(1, 2, 1.0);
+    EXPECT_EQ(1.0, copy.GetOmega(1,2));
+    EXPECT_EQ(3.0, bin.GetOmega(1,2));
+    EXPECT_NE(copy.Hash(), bin.Hash());
+
+    std::remove(textName.c_str());
+    std::remove(binName.c_str());
+}
+
+TEST(snimModel, TextScanSameAsStreams){
+    using namespace snim;
+
+    // Numbers converted by ScanDouble are the same as operator>> gives
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> unif(-1, 1);
+    std::uniform_int_distribution<int> expo(-30, 30), prec(1, 20);
+    for (int i = 0; i < 20000; ++i) {
+        std::ostringstream os;
+        os << std::setprecision(prec(rng));
+        if (i % 3 == 0)
+            os << std::scientific;
+        os << unif(rng) * std::pow(10.0, expo(rng));
+        std::string s = os.str();
+
+        std::istringstream is(s);
+        double expected = 0, value = 0;
+        is >> expected;
+        const char *p = s.data();
+        ASSERT_TRUE(ScanDouble(p, s.data() + s.size(), value)) << s;
+        EXPECT_EQ(expected, value) << s;
+        EXPECT_EQ(s.data() + s.size(), p);
+    }
+    for (std::string s : {"0", "-0.0", ".5", "5.", "+1e3", "1E-3", "0.00000000000000000000000123",
+                          "12345678901234567890123", "1.7976931348623157e308"}) {
+        std::istringstream is(s);
+        double expected = 0, value = 0;
+        is >> expected;
+        const char *p = s.data();
+        ASSERT_TRUE(ScanDouble(p, s.data() + s.size(), value)) << s;
+        EXPECT_EQ(expected, value) << s;
+    }
+    std::string bad = "  abc";
+    const char *p = bad.data();
+    double value = 0;
+    EXPECT_FALSE(ScanDouble(p, bad.data() + bad.size(), value));
+    EXPECT_EQ(bad.data(), p);
+
+    // Comments, blanks and tabs in the model and configuration files
+    std::string modelName = "testSnim_scan.par", cfgName = "testSnim_scan.cfg";
+    {
+        std::ofstream os(modelName);
+        os << "# Model\n3 10000   # species and size\n\n   \n0.1\t0.2  0.3\n1e0 2 3#extinction\n"
+              "0.0 0.0 0.0 0.0\n"
+              "0.0 0.0 3.0 2.0\n"
+              "4.0 0.0 0.0 0.0\n"
+              "2.0 0.0 0.5";
+        std::ofstream cs(cfgName);
+        cs << "# Simulation\n\tnEvals =  50 # evaluations\nrndSeed=77\n  \ntau = 0.01\t\n"
+              "iniCond = 0 10 20 30\n";
+    }
+    SnimModel mdl;
+    mdl.ReadModelParams(modelName);
+    EXPECT_EQ(3, mdl.GetNumberOfSpecies());
+    EXPECT_EQ(10000, mdl.GetCommunitySize());
+    EXPECT_FLOAT_EQ(3.0, mdl.GetOmega(1,2));
+    EXPECT_FLOAT_EQ(0.5, mdl.GetOmega(3,2));
+    EXPECT_FLOAT_EQ(0.0, mdl.GetOmega(3,3));
+
+    SimulationParameters sp(cfgName);
+    EXPECT_EQ(50, sp.nEvals);
+    EXPECT_EQ(77, sp.rndSeed);
+    EXPECT_EQ(0.01, sp.tau);
+    ASSERT_EQ(4, sp.iniCond.size());
+    EXPECT_EQ(30, sp.iniCond[3]);
+
+    // Lines longer than the blocks of the reader are the same as in place
+    std::ifstream ms(modelName, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(ms)), std::istreambuf_iterator<char>());
+    for (size_t block : {1, 3, 16, 1 << 20}) {
+        LineScanner scan(text.data(), text.size());
+        LineReader reader(modelName, block);
+        ASSERT_TRUE(reader.IsOpen());
+        const char *b1, *e1, *b2, *e2;
+        while (scan.Next(b1, e1)) {
+            ASSERT_TRUE(reader.Next(b2, e2)) << block;
+            EXPECT_EQ(std::string(b1, e1), std::string(b2, e2)) << block;
+            EXPECT_EQ(scan.LineNo(), reader.LineNo());
+        }
+        EXPECT_FALSE(reader.Next(b2, e2));
+    }
+    EXPECT_FALSE(LineReader("testSnim_missing.par").IsOpen());
+
+    std::remove(modelName.c_str());
+    std::remove(cfgName.c_str());
+}
+
+TEST(snimModel, GeneratedNetworks){
+    using namespace snim;
+
+    std::string cfgName = "testSnim_network.cfg";
+    {
+        std::ofstream cs(cfgName);
+        cs << "rndSeed = 5\nnEvals = 20\ntau = 0.1\niniCond = 100\n"
+              "network = niche\nnetworkSpecies = 200\nnetworkSize = 100000\nconnectance = 0.1\nnetworkSeed = 7\n";
+    }
+    NetworkParameters np(cfgName);
+    EXPECT_TRUE(np.Active());
+    EXPECT_EQ(200, np.nSpecies);
+    EXPECT_EQ(7, np.seed);
+
+    for (std::string type : {"niche", "cascade", "random", "mixed"}) {
+        np.type = type;
+        SnimModel a, b, c;
+        a.GenerateNetwork(np);
+        b.GenerateNetwork(np);
+        np.seed = 8;
+        c.GenerateNetwork(np);
+        np.seed = 7;
+        EXPECT_EQ(a.Hash(), b.Hash()) << type;
+        EXPECT_NE(a.Hash(), c.Hash()) << type;
+        EXPECT_EQ(200, a.GetNumberOfSpecies());
+        EXPECT_EQ(100000, a.GetCommunitySize());
+
+        // Links between species near the connectance, basal species grow on
+        // the empty space
+        size_t links = 0, basal = 0;
+        for (size_t i = 1; i <= 200; ++i) {
+            size_t prey = 0;
+            for (size_t j = 1; j <= 200; ++j)
+                if (a.GetOmega(i,j) > 0)
+                    ++prey;
+            links += prey;
+            EXPECT_GE(a.GetOmega(i,0), 0.0f);
+            if (a.GetOmega(i,0) > 0)
+                ++basal;
+        }
+        if (type != "mixed") {
+            EXPECT_NEAR(0.1, double(links) / (200*200), 0.03) << type;
+        }
+        EXPECT_GT(basal, 0) << type;
+
+        SimulationParameters sp(cfgName);
+        matrix<size_t> out;
+        a.SimulTauLeap(sp, out);
+        EXPECT_EQ(201, out.rows());
+    }
+
+    np.type = "lattice";
+    SnimModel bad;
+    EXPECT_THROW(bad.GenerateNetwork(np), std::invalid_argument);
+    std::remove(cfgName.c_str());
+}
+
+TEST(snimModel, CompiledModelCache){
+    using namespace snim;
+
+    std::string textName = "testSnim_cached.par", cacheName = "testSnim_cached.par.snc";
+    auto writeModel = [&](const char *omegaRow3){
+        std::ofstream os(textName);
+        os << "3 10000\n0.1 0.2 0.3\n1 2 3\n"
+              "0.0 0.0 0.0 0.0\n"
+              "0.0 0.0 3.0 2.0\n"
+              "4.0 0.0 0.0 0.0\n" << omegaRow3 << "\n";
+    };
+    writeModel("2.0 0.0 0.5 0.0");
+    std::remove(cacheName.c_str());
+
+    SnimModel text, first, cached;
+    text.ReadModelParams(textName);
+    EXPECT_FALSE(first.ReadModelParamsCached(textName, cacheName));
+    EXPECT_TRUE(cached.ReadModelParamsCached(textName, cacheName));
+    EXPECT_EQ(text.Hash(), cached.Hash());
+
+    // Channels by predator and by prey
+    auto cm = cached.GetCompiled();
+    ASSERT_EQ(5, cm->Channels());
+    EXPECT_TRUE(cm->IsView());
+    ASSERT_EQ(2, cm->PredatorEnd(1) - cm->PredatorBegin(1));
+    auto const &ch = (*cm)[cm->PredatorBegin(3) + 1];
+    EXPECT_EQ(3, ch.s);
+    EXPECT_EQ(2, ch.r);
+    EXPECT_FLOAT_EQ(0.5, ch.net);
+    ASSERT_EQ(2, cm->PreyEnd(2) - cm->PreyBegin(2));
+    for (size_t i = cm->PreyBegin(2); i < cm->PreyEnd(2); ++i)
+        EXPECT_EQ(2, (*cm)[cm->PreyChannel(i)].r);
+
+    SimulationParameters sp = {77,50,0.01, 1000};
+    matrix<size_t> a, b;
+    text.SimulTauLeap(sp, a);
+    cached.SimulTauLeap(sp, b);
+    EXPECT_TRUE(a == b);
+
+    // A change of the text file is compiled again
+    writeModel("2.0 0.0 0.7 0.0");
+    SnimModel changed;
+    EXPECT_FALSE(changed.ReadModelParamsCached(textName, cacheName));
+    EXPECT_FLOAT_EQ(0.7, changed.GetOmega(3,2));
+
+    // Changes of omega drop the compiled model of the file
+    cached.SetOmega(3, 2, 0.0);
+    EXPECT_EQ(4, cached.GetCompiled()->Channels());
+    EXPECT_FALSE(cached.GetCompiled()->IsView());
+
+    std::remove(textName.c_str());
+    std::remove(cacheName.c_str());
+}
+
+TEST(snimModel, PatchCompiledModel){
+    using namespace snim;
+
+    SnimModel base(3,10000);
+    base.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                    0.0, 0.0, 3.0, 2.0,
+                    4.0, 0.0, 0.0, 0.1,
+                    2.0, 0.0, 0.5, 0.0} );
+    base.SetExtinction({1,1,1});
+    base.SetInmigration({0.1,0.1,0.1});
+    base.Compile();
+
+    // Values that keep the channels are patched in place, in a copy of
+    // the compiled model of the base
+    SnimModel patched(base);
+    patched.SetOmega(3, 2, 0.25);
+    patched.SetOmega(2, 3, 0.3);
+    auto cm = patched.GetCompiled();
+    EXPECT_NE(base.GetCompiled().get(), cm.get());
+    EXPECT_EQ(base.GetCompiled()->Channels(), cm->Channels());
+    EXPECT_FLOAT_EQ(0.25 - 0.3, (*cm)[cm->Find(3,2)].net);
+    EXPECT_FLOAT_EQ(0.3 - 0.25, (*cm)[cm->Find(2,3)].net);
+    EXPECT_FLOAT_EQ(0.5 - 0.1, (*base.GetCompiled())[base.GetCompiled()->Find(3,2)].net);
+    EXPECT_EQ(cm->Channels(), cm->Find(2,1));
+
+    SnimModel rebuilt(3,10000);
+    rebuilt.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                       0.0, 0.0, 3.0, 2.0,
+                       4.0, 0.0, 0.0, 0.3,
+                       2.0, 0.0, 0.25, 0.0} );
+    rebuilt.SetExtinction({1,1,1});
+    rebuilt.SetInmigration({0.1,0.1,0.1});
+    EXPECT_EQ(rebuilt.Hash(), patched.Hash());
+
+    SimulationParameters sp = {77,50,0.01, 1000};
+    matrix<size_t> a, b;
+    patched.SimulTauLeap(sp, a);
+    rebuilt.SimulTauLeap(sp, b);
+    EXPECT_TRUE(a == b);
+
+    // A new channel compiles the model again
+    patched.SetOmega(2, 1, 1.0);
+    EXPECT_EQ(cm->Channels() + 1, patched.GetCompiled()->Channels());
+}
+
+TEST(snimModel, ParallelComponents){
+    using namespace snim;
+
+    // Two predator-prey pairs and a species alone, that share only the
+    // empty space
+    SnimModel mdl(5,100000);
+    mdl.SetOmega( {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                   1.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                   0.0, 2.0, 0.0, 0.0, 0.0, 0.0,
+                   1.5, 0.0, 0.0, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 0.0, 2.5, 0.0, 0.0,
+                   0.8, 0.0, 0.0, 0.0, 0.0, 0.0} );
+    mdl.SetExtinction({0.1,0.5,0.1,0.5,0.1});
+    mdl.SetInmigration({0.01,0.01,0.01,0.01,0.01});
+
+    auto comps = mdl.Components();
+    ASSERT_EQ(3u, comps.Count());
+    EXPECT_EQ(comps.component[1], comps.component[2]);
+    EXPECT_EQ(comps.component[3], comps.component[4]);
+    EXPECT_NE(comps.component[1], comps.component[3]);
+    EXPECT_EQ(2u, comps.Size(comps.component[3]));
+    EXPECT_EQ(3u, comps.Species(comps.component[3])[0]);
+    EXPECT_EQ(2u, comps.channels[comps.component[1]]);
+
+    // The result depends on the seed but not on the number of threads
+    SimulationParameters sp = {77,50,0.01, 1000};
+    sp.componentThreads = 1;
+    matrix<size_t> one, three;
+    mdl.SimulTauLeap(sp, one);
+    sp.componentThreads = 3;
+    mdl.SimulTauLeap(sp, three);
+    EXPECT_TRUE(one == three);
+    for (size_t s = 1; s <= 5; ++s)
+        EXPECT_GT(one(s, 50), 0u);
+
+    // A model that is a single component is simulated as in the serial mode
+    SnimModel whole(3,10000);
+    whole.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                     0.0, 0.0, 3.0, 2.0,
+                     4.0, 0.0, 0.0, 0.1,
+                     2.0, 0.0, 0.5, 0.0} );
+    whole.SetExtinction({1,1,1});
+    whole.SetInmigration({0.1,0.1,0.1});
+    EXPECT_EQ(1u, whole.Components().Count());
+    matrix<size_t> serial, parallel;
+    sp.componentThreads = 0;
+    whole.SimulTauLeap(sp, serial);
+    sp.componentThreads = 2;
+    whole.SimulTauLeap(sp, parallel);
+    EXPECT_TRUE(serial == parallel);
+}
+
+TEST(snimModel, ReorderSpecies){
+    using namespace snim;
+
+    // A food chain with the species numbered at random: each species eats
+    // the one below, the first one grows on the empty space
+    const size_t n = 40;
+    std::vector<uint32_t> label(n);
+    for (size_t i = 0; i < n; ++i)
+        label[i] = i + 1;
+    std::shuffle(label.begin(), label.end(), std::mt19937(5));
+
+    SnimModel chain(n, 100000);
+    chain.SetOmega(label[0], 0, 1.0);
+    for (size_t i = 1; i < n; ++i) {
+        chain.SetOmega(label[i], label[i-1], 1.5);
+        chain.SetExtinction(label[i], 0.05 * (i % 3 + 1));
+        chain.SetInmigration(label[i], 0.001 * (i % 4 + 1));
+    }
+    chain.SetExtinction(label[0], 0.1);
+    chain.SetInmigration(label[0], 0.01);
+
+    auto order = BandwidthOrder(*chain.GetCompiled());
+    ASSERT_EQ(n + 1, order.size());
+    EXPECT_EQ(0u, order[0]);
+    std::vector<uint32_t> sorted(order);
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t k = 0; k <= n; ++k)
+        EXPECT_EQ(k, sorted[k]);
+
+    // In the new numbering the links of the chain join consecutive species
+    std::vector<uint32_t> inv(n + 1);
+    for (size_t k = 0; k <= n; ++k)
+        inv[order[k]] = k;
+    for (size_t i = 1; i < n; ++i)
+        EXPECT_EQ(1, std::abs(int(inv[label[i]]) - int(inv[label[i-1]])));
+
+    // The reordered simulation is the one of the renumbered model, with the
+    // species given back in the original order
+    SnimModel renumbered(n, 100000);
+    for (size_t r = 0; r <= n; ++r)
+        for (size_t c = 0; c <= n; ++c)
+            if (chain.GetOmega(order[r], order[c]) != 0)
+                renumbered.SetOmega(r, c, chain.GetOmega(order[r], order[c]));
+    renumbered.SetExtinction(inv[label[0]], 0.1);
+    renumbered.SetInmigration(inv[label[0]], 0.01);
+    for (size_t i = 1; i < n; ++i) {
+        renumbered.SetExtinction(inv[label[i]], 0.05 * (i % 3 + 1));
+        renumbered.SetInmigration(inv[label[i]], 0.001 * (i % 4 + 1));
+    }
+
+    SimulationParameters sp = {77,50,0.01, 500};
+    matrix<size_t> serial, reordered;
+    renumbered.SimulTauLeap(sp, serial);
+    sp.reorderSpecies = true;
+    chain.SimulTauLeap(sp, reordered);
+    for (size_t k = 0; k <= n; ++k)
+        for (size_t t = 0; t <= 50; ++t)
+            EXPECT_EQ(serial(k, t), reordered(order[k], t));
+    EXPECT_GT(reordered(label[n-1], 50), 0u);
+}
+
+TEST(snimMatrix, AlignedStorage){
+    using namespace snim;
+
+    matrix<size_t> packed(13, 4, {0,1,2,3,4,5,6,7,8,9,10,11,12,
+                                  13,14,15,16,17,18,19,20,21,22,23,24,25,
+                                  26,27,28,29,30,31,32,33,34,35,36,37,38,
+                                  39,40,41,42,43,44,45,46,47,48,49,50,51});
+    matrix<size_t, AlignedStorage> aligned(13, 4, {0,1,2,3,4,5,6,7,8,9,10,11,12,
+                                                   13,14,15,16,17,18,19,20,21,22,23,24,25,
+                                                   26,27,28,29,30,31,32,33,34,35,36,37,38,
+                                                   39,40,41,42,43,44,45,46,47,48,49,50,51});
+    EXPECT_EQ(13u, packed.ld());
+    EXPECT_EQ(16u, aligned.ld());
+    EXPECT_EQ(64u, aligned.padded_size());
+    for (size_t c = 0; c < 4; ++c) {
+        EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(aligned.col_data(c)) % 64);
+        for (size_t r = 0; r < 13; ++r)
+            EXPECT_EQ(packed(r, c), aligned(r, c));
+        for (size_t r = 13; r < 16; ++r)
+            EXPECT_EQ(0u, aligned.col_data(c)[r]);
+        EXPECT_EQ(packed.col_sum(c), aligned.col_sum(c));
+    }
+    for (size_t r = 0; r < 13; ++r)
+        EXPECT_EQ(packed.row_sum(r), aligned.row_sum(r));
+
+    auto copy = aligned;
+    EXPECT_TRUE(copy == aligned);
+    copy(12, 3) = 0;
+    EXPECT_FALSE(copy == aligned);
+    auto col = aligned.column(2);
+    EXPECT_EQ(26u, col(0, 0));
+    EXPECT_EQ(38u, col(12, 0));
+
+    matrix<double, AlignedStorage> filled(3, 5, 1.5);
+    EXPECT_EQ(8u, filled.ld());
+    EXPECT_DOUBLE_EQ(7.5, filled.row_sum(2));
+    filled.resize(17, 2);
+    EXPECT_EQ(24u, filled.ld());
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(filled.data()) % 64);
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include "snim.h"
+#include "stats.h"
+
+TEST(snimStats, SameAsTrajectory){
+    using namespace snim;
+
+    SnimModel mdl(3,10000);
+    mdl.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 3.0, 2.0,
+                   4.0, 0.0, 0.0, 0.0,
+                   2.0, 0.0, 0.5, 0.0} );
+    mdl.SetExtinction({1.0,1.0,1.0});
+    mdl.SetInmigration({0.1,0.1,0.1});
+    SimulationParameters sp = {77,100,0.01, 1000};
+
+    matrix <size_t> N;
+    mdl.SimulTauLeap(sp,N);
+
+    size_t from = 40;
+    StatsSink stats(from);
+    mdl.SimulTauLeap(sp,stats);
+    ASSERT_EQ(N.cols() - from, stats.Count());
+
+    for (size_t r = 0; r < N.rows(); ++r) {
+        double sum = 0, sum2 = 0;
+        for (size_t c = from; c < N.cols(); ++c)
+            sum += N(r,c);
+        double mean = sum / stats.Count();
+        for (size_t c = from; c < N.cols(); ++c)
+            sum2 += (N(r,c) - mean) * (N(r,c) - mean);
+        EXPECT_NEAR(mean, stats.Mean(r), 1e-9 * mean + 1e-12);
+        EXPECT_NEAR(sum2 / (stats.Count() - 1), stats.Variance(r), 1e-6 * sum2 / stats.Count() + 1e-9);
+    }
+
+    // Richness and diversity of each column
+    ASSERT_EQ(stats.Count(), stats.Richness().size());
+    for (size_t c = from; c < N.cols(); ++c) {
+        double S = 0, H = 0;
+        for (size_t r = 1; r < N.rows(); ++r)
+            if (N(r,c) > 0) {
+                double freq = N(r,c) / 10000.0;
+                S += 1;
+                H -= freq * std::log(freq);
+            }
+        EXPECT_EQ(S, stats.Richness()[c - from]);
+        EXPECT_NEAR(H, stats.Shannon()[c - from], 1e-12);
+    }
+
+    auto st = CalcSummaryStats(N, from, 10000);
+    EXPECT_EQ(st.S, stats.Summary().S);
+    EXPECT_NEAR(st.H, stats.Summary().H, 1e-12);
+
+    // Nothing to accumulate
+    StatsSink late(1000);
+    mdl.SimulTauLeap(sp,late);
+    EXPECT_EQ(0, late.Count());
+    EXPECT_EQ(0, late.Summary().S);
+}
+
+TEST(snimStats, RecordedSpecies){
+    using namespace snim;
+
+    SnimModel mdl(3,10000);
+    mdl.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 3.0, 2.0,
+                   4.0, 0.0, 0.0, 0.0,
+                   2.0, 0.0, 0.5, 0.0} );
+    mdl.SetExtinction({1.0,1.0,1.0});
+    mdl.SetInmigration({0.1,0.1,0.1});
+    SimulationParameters sp = {77,100,0.01, 1000};
+
+    StatsSink all(40);
+    mdl.SimulTauLeap(sp,all);
+
+    // Without the empty space every row is a species
+    sp.recordSpecies = {2, 3};
+    StatsSink part(40);
+    mdl.SimulTauLeap(sp,part);
+    ASSERT_EQ(all.Count(), part.Count());
+    EXPECT_EQ(2u, part.Species(0));
+    EXPECT_EQ(3u, part.Species(1));
+    EXPECT_DOUBLE_EQ(all.Mean(2), part.Mean(0));
+    EXPECT_DOUBLE_EQ(all.Mean(3), part.Mean(1));
+
+    double S = 0, H = 0;
+    for (size_t r = 2; r <= 3; ++r)
+        if (all.Mean(r) > 0) {
+            double freq = all.Mean(r) / 10000.0;
+            S += 1;
+            H -= freq * std::log(freq);
+        }
+    EXPECT_GT(S, 0);
+    EXPECT_EQ(S, part.Summary().S);
+    EXPECT_NEAR(H, part.Summary().H, 1e-12);
+
+    std::ostringstream os;
+    part.Write(os);
+    EXPECT_NE(std::string::npos, os.str().find("\n2\t"));
+    EXPECT_NE(std::string::npos, os.str().find("\n3\t"));
+
+    // The empty space can be in any row
+    sp.recordSpecies = {3, 0, 1};
+    StatsSink mixed(40);
+    mdl.SimulTauLeap(sp,mixed);
+    EXPECT_DOUBLE_EQ(all.Mean(0), mixed.Mean(1));
+    SummaryStats st;
+    for (size_t r : {1, 3})
+        if (all.Mean(r) > 0) {
+            double freq = all.Mean(r) / 10000.0;
+            st.S += 1;
+            st.H -= freq * std::log(freq);
+        }
+    EXPECT_EQ(st.S, mixed.Summary().S);
+    EXPECT_NEAR(st.H, mixed.Summary().H, 1e-12);
+}
+
+TEST(snimStats, RecordingWindow){
+    using namespace snim;
+
+    SnimModel mdl(3,10000);
+    mdl.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 3.0, 2.0,
+                   4.0, 0.0, 0.0, 0.0,
+                   2.0, 0.0, 0.5, 0.0} );
+    mdl.SetExtinction({1.0,1.0,1.0});
+    mdl.SetInmigration({0.1,0.1,0.1});
+    SimulationParameters sp = {77,100,0.01, 1000};
+
+    matrix <size_t> N;
+    mdl.SimulTauLeap(sp,N);
+
+    // The window starts at evaluation 40 whatever the columns recorded
+    sp.recordStart = 10;
+    sp.recordStride = 5;
+    StatsSink stats(40);
+    mdl.SimulTauLeap(sp,stats);
+    ASSERT_EQ(13, stats.Count());
+    EXPECT_EQ(40, stats.FirstEval());
+
+    for (size_t r = 0; r < N.rows(); ++r) {
+        double sum = 0;
+        for (size_t c = 40; c < N.cols(); c += 5)
+            sum += N(r,c);
+        EXPECT_NEAR(sum / 13, stats.Mean(r), 1e-9 * sum + 1e-12);
+    }
+
+    // The series of richness and diversity are written with their evaluation
+    std::ostringstream os;
+    stats.Write(os);
+    std::ostringstream line;
+    line << "\n45\t" << stats.Richness()[1] << "\t" << stats.Shannon()[1] << "\n";
+    EXPECT_NE(std::string::npos, os.str().find("time\tS\tH\n40\t"));
+    EXPECT_NE(std::string::npos, os.str().find(line.str()));
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include "sweep.h"
+#include "threadpool.h"
+
+TEST(snimSweep, GridExpansion){
+    using namespace snim;
+
+    SweepSpec spec;
+    spec.replicates = 2;
+    spec.AddAxis("tau", "0.01 0.005");
+    spec.AddAxis("e[2]", "0.5 1 2");
+    spec.AddAxis("iniCond", "1000 ; 10 20 30");
+
+    EXPECT_EQ(2*2*3*2, spec.JobCount());
+
+    // replicate varies fastest then the axes in order
+    auto lv = spec.JobLevels(2*1 + 2*2*2 + 2*2*3*1);
+    EXPECT_EQ(1, lv[0]);
+    EXPECT_EQ(2, lv[1]);
+    EXPECT_EQ(1, lv[2]);
+}
+
+TEST(snimSweep, ApplyJob){
+    using namespace snim;
+
+    SnimModel mdl(3,10000);
+    mdl.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 1.0, 1.0,
+                   0.1, 0.0, 0.0, 0.3,
+                   0.1, 0.0, 0.2, 0.0} );
+    mdl.SetExtinction({0.5,0.5,0.5});
+    mdl.SetInmigration({0.0,0.0,0.0});
+
+    SweepSpec spec;
+    spec.AddAxis("communitySize", "5000 20000");
+    spec.AddAxis("iniCond", "1000 ; 10 20 30");
+
+    SimulationParameters sp {1234,10,0.01, 100};
+    spec.ApplyJob(3, mdl, sp);
+
+    EXPECT_EQ(20000, mdl.GetCommunitySize());
+    ASSERT_EQ(3, sp.iniCond.size());
+    EXPECT_EQ(30, sp.iniCond[2]);
+
+    matrix <size_t> out;
+    mdl.SimulTauLeap(sp,out);
+    EXPECT_EQ(20000-60, out(0,0));
+
+    EXPECT_THROW(spec.AddAxis("e", "0.1"), std::invalid_argument);
+    EXPECT_THROW(spec.AddAxis("omega", "0.1"), std::invalid_argument);
+}
+
+TEST(snimSweep, Overrides){
+    using namespace snim;
+
+    SnimModel mdl(3,10000);
+    mdl.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 1.0, 1.0,
+                   0.1, 0.0, 0.0, 0.3,
+                   0.1, 0.0, 0.2, 0.0} );
+    mdl.SetExtinction({0.5,0.5,0.5});
+    mdl.SetInmigration({0.0,0.0,0.0});
+
+    SweepSpec spec;
+    spec.AddOverride("omega[2,3]=0.5");
+    spec.AddOverride("omega[3,0] = 0");
+    spec.AddOverride("omegaScale[1,2]=2.5");
+    spec.AddOverride("e[1]=0.2");
+    spec.AddOverride("tau=0.005");
+    spec.AddOverride("nEvals=7");
+    spec.AddOverride("iniCond=10 20 30");
+    EXPECT_EQ(1, spec.JobCount());
+
+    SimulationParameters sp {1234,10,0.01, 100};
+    spec.ApplyJob(0, mdl, sp);
+    EXPECT_FLOAT_EQ(0.5, mdl.GetOmega(2,3));
+    EXPECT_FLOAT_EQ(0.0, mdl.GetOmega(3,0));
+    EXPECT_FLOAT_EQ(2.5, mdl.GetOmega(1,2));
+    EXPECT_FLOAT_EQ(1.0, mdl.GetOmega(1,3));
+    EXPECT_EQ(0.005, sp.tau);
+    EXPECT_EQ(7, sp.nEvals);
+    ASSERT_EQ(3, sp.iniCond.size());
+
+    EXPECT_THROW(spec.AddOverride("tau"), std::invalid_argument);
+    EXPECT_THROW(spec.AddOverride("tau=0.1 0.2"), std::invalid_argument);
+    EXPECT_THROW(spec.AddOverride("omega[2]=1"), std::invalid_argument);
+    EXPECT_THROW(spec.AddOverride("omegaScale[2]=1"), std::invalid_argument);
+
+    SweepSpec outside;
+    outside.AddOverride("omega[4,1]=1");
+    EXPECT_THROW(outside.ApplyJob(0, mdl, sp), std::invalid_argument);
+}
+
+TEST(snimThreadPool, PinnedWorkers){
+    using namespace snim;
+
+    auto cpus = NumaTopology::ParseCpuList("0-3,8,10-11");
+    ASSERT_EQ(7, cpus.size());
+    EXPECT_EQ(8, cpus[4]);
+    EXPECT_EQ(11, cpus[6]);
+
+    ThreadPool pool(3, true);
+    std::vector<size_t> ran(pool.size(), 0);
+    pool.RunOnEach([&](size_t w){ ++ran[w]; });
+    for (auto r : ran)
+        EXPECT_EQ(1, r);
+
+    std::vector<size_t> done(100, 0);
+    pool.Run(done.size(), [&](size_t job, size_t){ ++done[job]; });
+    for (auto d : done)
+        EXPECT_EQ(1, d);
+
+    std::ostringstream report;
+    pool.Report(report);
+    EXPECT_NE(std::string::npos, report.str().find("100 jobs"));
+}
@@ -0,0 +1,618 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include "snim.h"
+#include "stats.h"
+#include "trajfile.h"
+#include "tsvwriter.h"
+
+static snim::SnimModel PredatorPrey(){
+    using namespace snim;
+
+    SnimModel mdl(3,10000);
+    mdl.SetOmega( {0.0, 0.0, 0.0, 0.0,
+                   0.0, 0.0, 3.0, 2.0,
+                   4.0, 0.0, 0.0, 0.0,
+                   2.0, 0.0, 0.5, 0.0} );
+    mdl.SetExtinction({1.0,1.0,1.0});
+    mdl.SetInmigration({0.1,0.1,0.1});
+    return mdl;
+}
+
+static std::string ReadFile(const std::string &fName){
+    std::ifstream is(fName, std::ios::binary);
+    std::stringstream s;
+    s << is.rdbuf();
+    return s.str();
+}
+
+TEST(snimTrajectory, StreamSinkSameAsMatrix){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,50,0.01, 1000};
+
+    matrix <size_t> out;
+    mdl.SimulTauLeap(sp,out);
+
+    std::string fName = "testTrajectory_stream.txt";
+    {
+        TsvStreamSink sink(fName);
+        mdl.SimulTauLeap(sp,sink);
+    }
+
+    // One line for each evaluation
+    std::ifstream is(fName);
+    for (size_t c = 0; c < out.cols(); ++c)
+        for (size_t r = 0; r < out.rows(); ++r) {
+            size_t v = 0;
+            ASSERT_TRUE(static_cast<bool>(is >> v));
+            EXPECT_EQ(out(r,c), v);
+        }
+    std::remove(fName.c_str());
+
+    EXPECT_THROW(MakeFileSink("nothing", fName), std::invalid_argument);
+}
+
+TEST(snimTrajectory, BinaryRoundTrip){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,300,0.01, 1000};
+
+    matrix <size_t> out;
+    mdl.SimulTauLeap(sp,out);
+
+    std::string fName = "testTrajectory_binary.trj";
+    {
+        BinaryTrajectorySink sink(fName, mdl.Hash());
+        mdl.SimulTauLeap(sp,sink);
+    }
+
+    TrajectoryFile in(fName);
+    EXPECT_EQ(out.rows(), in.Rows());
+    EXPECT_EQ(out.cols(), in.Cols());
+    EXPECT_EQ(1234, in.Seed());
+    EXPECT_EQ(mdl.Hash(), in.ModelHash());
+    EXPECT_EQ(4, in.CountBytes());
+
+    auto raw = static_cast<const uint32_t*>(in.RawColumn(7));
+    ASSERT_NE(nullptr, raw);
+    EXPECT_EQ(out(2,7), raw[2]);
+
+    auto s = in.Series(3);
+    for (size_t c = 0; c < out.cols(); ++c)
+        EXPECT_EQ(out(3,c), s[c]);
+
+    std::ostringstream tsv, expected;
+    in.WriteTsv(tsv);
+    for (size_t r = 0; r < out.rows(); ++r) {
+        expected << out(r,0);
+        for (size_t c = 1; c < out.cols(); ++c)
+            expected << "\t" << out(r,c);
+        expected << "\n";
+    }
+    EXPECT_EQ(expected.str(), tsv.str());
+    std::remove(fName.c_str());
+}
+
+TEST(snimTrajectory, SparseRoundTrip){
+    using namespace snim;
+
+    // A large pool where only the predator prey species can be present
+    SnimModel mdl(40,10000);
+    auto small = PredatorPrey();
+    for (size_t r = 0; r < 4; ++r)
+        for (size_t c = 0; c < 4; ++c)
+            mdl.SetOmega(r, c, small.GetOmega(r, c));
+    for (size_t s = 1; s <= 3; ++s) {
+        mdl.SetExtinction(s, 1.0);
+        mdl.SetInmigration(s, 0.1);
+    }
+    SimulationParameters sp = {4321,100,0.01, 1000};
+    sp.iniCond.assign(40, 0);
+    for (size_t s = 0; s < 3; ++s)
+        sp.iniCond[s] = 100;
+
+    matrix <size_t> out;
+    mdl.SimulTauLeap(sp,out);
+
+    std::string rawName = "testTrajectory_raw.trj", sparseName = "testTrajectory_sparse.trj";
+    {
+        auto raw = MakeFileSink("binary", rawName, mdl.Hash());
+        mdl.SimulTauLeap(sp,*raw);
+        auto sparse = MakeFileSink("sparse", sparseName, mdl.Hash());
+        mdl.SimulTauLeap(sp,*sparse);
+    }
+
+    TrajectoryFile raw(rawName), in(sparseName);
+    EXPECT_EQ(out.rows(), in.Rows());
+    EXPECT_EQ(out.cols(), in.Cols());
+    EXPECT_EQ(nullptr, in.RawColumn(0));
+
+    std::vector<size_t> col(in.Rows());
+    in.ReadColumn(60, col.data());
+    for (size_t r = 0; r < out.rows(); ++r)
+        EXPECT_EQ(out(r,60), col[r]);
+
+    for (size_t r : {0, 2, 3, 20}) {
+        auto s = in.Series(r);
+        for (size_t c = 0; c < out.cols(); ++c)
+            EXPECT_EQ(out(r,c), s[c]);
+    }
+
+    std::ostringstream a, b;
+    raw.WriteTsv(a);
+    in.WriteTsv(b);
+    EXPECT_EQ(a.str(), b.str());
+
+    std::ifstream fr(rawName, std::ios::binary | std::ios::ate), fs(sparseName, std::ios::binary | std::ios::ate);
+    EXPECT_LT(4 * fs.tellg(), fr.tellg());
+
+    std::remove(rawName.c_str());
+    std::remove(sparseName.c_str());
+}
+
+TEST(snimTrajectory, CorruptedSparseFile){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,50,0.01, 1000};
+
+    std::string fName = "testTrajectory_corrupt.trj";
+    {
+        auto sink = MakeFileSink("sparse", fName, mdl.Hash());
+        mdl.SimulTauLeap(sp,*sink);
+    }
+    std::string good = ReadFile(fName);
+
+    // The first column starts after the file header, the layout and the block header
+    size_t firstCol = sizeof(TrajFileHeader) + sizeof(TrajFileLayout) + sizeof(TrajBlockHeader);
+    auto corrupt = [&](size_t pos, uint32_t v){
+        std::string bad = good;
+        std::memcpy(&bad[pos], &v, sizeof(v));
+        std::ofstream os(fName, std::ios::binary);
+        os << bad;
+    };
+
+    corrupt(firstCol, 1000000);             // More species than rows
+    EXPECT_THROW(TrajectoryFile in(fName), std::runtime_error);
+
+    corrupt(firstCol + 4, 4000000000u);     // A row far outside the column
+    TrajectoryFile in(fName);
+    std::vector<size_t> col(in.Rows());
+    EXPECT_THROW(in.ReadColumn(0, col.data()), std::runtime_error);
+
+    std::string cut = good.substr(0, good.size() - 16);
+    std::string truncated = fName + ".cut";
+    {
+        std::ofstream os(truncated, std::ios::binary);
+        os << cut;
+    }
+    TrajectoryFile partial(truncated);      // The incomplete last block is ignored
+    EXPECT_EQ(0, partial.Cols());
+
+    std::remove(fName.c_str());
+    std::remove(truncated.c_str());
+}
+
+TEST(snimTrajectory, CompressedRoundTrip){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,300,0.01, 1000};
+
+    matrix <size_t> out;
+    mdl.SimulTauLeap(sp,out);
+
+    std::string rawName = "testTrajectory_raw.trj", deltaName = "testTrajectory_delta.trj";
+    {
+        auto raw = MakeFileSink("binary", rawName, mdl.Hash());
+        mdl.SimulTauLeap(sp,*raw);
+        auto delta = MakeFileSink("compressed", deltaName, mdl.Hash());
+        mdl.SimulTauLeap(sp,*delta);
+    }
+
+    TrajectoryFile raw(rawName), in(deltaName);
+    EXPECT_EQ(out.rows(), in.Rows());
+    EXPECT_EQ(out.cols(), in.Cols());
+    EXPECT_EQ(nullptr, in.RawColumn(0));
+
+    // Random access to columns and values
+    std::vector<size_t> col(in.Rows());
+    for (size_t c : {250, 3, 300, 0}) {
+        in.ReadColumn(c, col.data());
+        for (size_t r = 0; r < out.rows(); ++r) {
+            EXPECT_EQ(out(r,c), col[r]);
+            EXPECT_EQ(out(r,c), in.Value(r,c));
+        }
+    }
+
+    auto s = in.Series(2);
+    for (size_t c = 0; c < out.cols(); ++c)
+        EXPECT_EQ(out(2,c), s[c]);
+
+    std::ostringstream a, b;
+    raw.WriteTsv(a);
+    in.WriteTsv(b);
+    EXPECT_EQ(a.str(), b.str());
+
+    std::ifstream fr(rawName, std::ios::binary | std::ios::ate), fd(deltaName, std::ios::binary | std::ios::ate);
+    EXPECT_LT(2 * fd.tellg(), fr.tellg());
+
+    std::remove(rawName.c_str());
+    std::remove(deltaName.c_str());
+}
+
+class FailingSink : public snim::TrajectorySink {
+public:
+    void Column(size_t col, const size_t *values) override {
+        (void)values;
+        if (col == 40)
+            throw std::runtime_error("disk full");
+    }
+};
+
+TEST(snimTrajectory, AsyncSinkSameAsMatrix){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,200,0.01, 1000};
+
+    matrix <size_t> out, async;
+    mdl.SimulTauLeap(sp,out);
+
+    // Small buffers of 3 columns so the buffers are swapped many times
+    {
+        AsyncSink sink(std::unique_ptr<TrajectorySink>(new MatrixSink(async)), 3 * 4 * sizeof(size_t));
+        mdl.SimulTauLeap(sp,sink);
+    }
+    EXPECT_EQ(out.rows(), async.rows());
+    ASSERT_EQ(out.cols(), async.cols());
+    for (size_t c = 0; c < out.cols(); ++c)
+        for (size_t r = 0; r < out.rows(); ++r)
+            EXPECT_EQ(out(r,c), async(r,c));
+
+    // Errors of the writer thread reach the simulation
+    AsyncSink failing(std::unique_ptr<TrajectorySink>(new FailingSink()), 4 * sizeof(size_t));
+    EXPECT_THROW(mdl.SimulTauLeap(sp,failing), std::runtime_error);
+}
+
+TEST(snimTrajectory, FastTsvSameAsOperator){
+    using namespace snim;
+
+    char buf[maxDigits];
+    for (uint64_t v : {uint64_t(0), uint64_t(7), uint64_t(10), uint64_t(99), uint64_t(100),
+                       uint64_t(123456789), UINT64_MAX}) {
+        char *end = FormatUnsigned(buf, v);
+        EXPECT_EQ(std::to_string(v), std::string(buf, end));
+    }
+
+    // More rows than a band and a partial last band
+    matrix<size_t> m(37, 50, size_t(0));
+    for (size_t i = 0; i < m.size(); ++i)
+        m[i] = (i * 2654435761u) % 100003;
+
+    std::string fName = "testTrajectory_fast.txt";
+    {
+        std::ofstream os(fName);
+        os << m;
+    }
+    std::ifstream is(fName);
+    std::stringstream expected;
+    expected << is.rdbuf();
+    std::remove(fName.c_str());
+
+    std::ostringstream fast;
+    WriteTsv(fast, m);
+    EXPECT_EQ(expected.str(), fast.str());
+}
+
+TEST(snimTrajectory, RecordingWindow){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,100,0.01, 1000};
+
+    matrix <size_t> out;
+    mdl.SimulTauLeap(sp,out);
+
+    sp.recordStart = 10;
+    sp.recordStride = 7;
+    sp.recordSpecies = {3, 1};
+    EXPECT_EQ(13, sp.RecordedEvals());
+
+    matrix <size_t> part;
+    mdl.SimulTauLeap(sp,part);
+    ASSERT_EQ(2, part.rows());
+    ASSERT_EQ(13, part.cols());
+    for (size_t c = 0; c < part.cols(); ++c) {
+        EXPECT_EQ(out(3, 10 + 7*c), part(0,c));
+        EXPECT_EQ(out(1, 10 + 7*c), part(1,c));
+    }
+
+    // The binary file keeps the species of each row and the time axis
+    std::string fName = "testTrajectory_window.trj";
+    {
+        auto sink = MakeFileSink("compressed", fName, mdl.Hash());
+        mdl.SimulTauLeap(sp,*sink);
+    }
+    {
+        TrajectoryFile in(fName);
+        ASSERT_EQ(2, in.Rows());
+        ASSERT_EQ(13, in.Cols());
+        EXPECT_EQ(3, in.SpeciesOf(0));
+        EXPECT_EQ(1, in.SpeciesOf(1));
+        EXPECT_EQ(10, in.EvalOf(0));
+        EXPECT_EQ(94, in.EvalOf(12));
+        EXPECT_EQ(part(1,5), in.Value(1,5));
+
+        std::ostringstream tsv;
+        in.WriteTsv(tsv);
+        std::istringstream lines(tsv.str());
+        std::string line;
+        std::getline(lines, line);
+        EXPECT_EQ(0, line.find("Species\t10\t17\t"));
+        std::getline(lines, line);
+        EXPECT_EQ(0, line.find("3\t" + std::to_string(part(0,0)) + "\t"));
+    }
+    std::remove(fName.c_str());
+
+    sp.recordStart = 101;
+    EXPECT_EQ(0, sp.RecordedEvals());
+
+    sp.recordStart = 0;
+    sp.recordSpecies = {4};
+    EXPECT_THROW(mdl.SimulTauLeap(sp,part), std::invalid_argument);
+}
+
+// Stops the simulation after some columns, like a node that reboots
+class InterruptedSink : public snim::TsvStreamSink {
+    size_t stopAt;
+
+public:
+    InterruptedSink(const std::string &fName, size_t stop) : TsvStreamSink(fName), stopAt(stop) {}
+
+    void Column(size_t col, const size_t *values) override {
+        if (col == stopAt)
+            throw std::runtime_error("interrupted");
+        TsvStreamSink::Column(col, values);
+    }
+};
+
+TEST(snimTrajectory, CheckpointResume){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,100,0.01, 1000};
+    sp.checkpointEvery = 30;
+    sp.checkpointFile = "testTrajectory.chk";
+
+    std::string fullName = "testTrajectory_full.txt", partName = "testTrajectory_part.txt";
+    {
+        TsvStreamSink full(fullName);
+        mdl.SimulTauLeap(sp,full);
+    }
+
+    // Interrupted after the checkpoint of evaluation 60
+    {
+        InterruptedSink part(partName, 75);
+        EXPECT_THROW(mdl.SimulTauLeap(sp,part), std::runtime_error);
+    }
+    Checkpoint chk;
+    chk.Load(sp.checkpointFile);
+    EXPECT_EQ(60, chk.eval);
+    EXPECT_EQ(61, chk.col);
+    EXPECT_EQ(1234, chk.seed);
+
+    {
+        auto part = MakeFileSink("stream", partName, mdl.Hash(), true);
+        mdl.SimulTauLeap(sp,*part,&chk);
+    }
+    EXPECT_EQ(ReadFile(fullName), ReadFile(partName));
+
+    // The binary formats continue after the last block written
+    for (std::string format : {"binary", "compressed"}) {
+        std::string binName = "testTrajectory_chk.trj";
+        matrix<size_t> out;
+        mdl.SimulTauLeap(sp,out);
+        {
+            AsyncSink bin(MakeFileSink(format, binName, mdl.Hash()));
+            mdl.SimulTauLeap(sp,bin);
+        }
+        chk.Load(sp.checkpointFile);
+        EXPECT_EQ(90, chk.eval);
+        {
+            AsyncSink bin(MakeFileSink(format, binName, mdl.Hash(), true));
+            mdl.SimulTauLeap(sp,bin,&chk);
+        }
+        TrajectoryFile in(binName);
+        ASSERT_EQ(out.cols(), in.Cols());
+        for (size_t r = 0; r < out.rows(); ++r) {
+            auto s = in.Series(r);
+            for (size_t c = 0; c < out.cols(); ++c)
+                EXPECT_EQ(out(r,c), s[c]);
+        }
+        std::remove(binName.c_str());
+    }
+
+    // Other model
+    auto other = PredatorPrey();
+    other.SetExtinction(1, 0.5);
+    matrix<size_t> out;
+    MatrixSink mem(out);
+    EXPECT_THROW(other.SimulTauLeap(sp,mem,&chk), std::invalid_argument);
+
+    // Other layout of the output
+    chk.Load(sp.checkpointFile);
+    EXPECT_EQ(sp.outputFormat, chk.outputFormat);
+    for (int change = 0; change < 4; ++change) {
+        SimulationParameters osp(sp);
+        if (change == 0)
+            osp.recordStart = 10;
+        else if (change == 1)
+            osp.recordStride = 2;
+        else if (change == 2)
+            osp.recordSpecies = {1, 2};
+        else
+            osp.outputFormat = "binary";
+        EXPECT_THROW(mdl.SimulTauLeap(osp,mem,&chk), std::invalid_argument);
+    }
+
+    std::remove(fullName.c_str());
+    std::remove(partName.c_str());
+    std::remove(sp.checkpointFile.c_str());
+}
+
+// Statistics sink that stops like InterruptedSink
+class InterruptedStats : public snim::StatsFileSink {
+    size_t stopAt;
+
+public:
+    InterruptedStats(const std::string &fName, size_t from, size_t stop) : StatsFileSink(fName, from), stopAt(stop) {}
+
+    void Column(size_t col, const size_t *values) override {
+        if (col == stopAt)
+            throw std::runtime_error("interrupted");
+        StatsFileSink::Column(col, values);
+    }
+};
+
+TEST(snimTrajectory, CheckpointResumeStats){
+    using namespace snim;
+
+    auto mdl = PredatorPrey();
+    SimulationParameters sp = {1234,100,0.01, 1000};
+    sp.outputFormat = "stats";
+    sp.statsFrom = 20;
+    sp.checkpointEvery = 30;
+    sp.checkpointFile = "testTrajectory_stats.chk";
+
+    std::string fullName = "testTrajectory_full.sts", partName = "testTrajectory_part.sts";
+    {
+        StatsFileSink full(fullName, sp.statsFrom);
+        mdl.SimulTauLeap(sp,full);
+    }
+
+    // The means, variances and series before the checkpoint are restored
+    {
+        InterruptedStats part(partName, sp.statsFrom, 75);
+        EXPECT_THROW(mdl.SimulTauLeap(sp,part), std::runtime_error);
+    }
+    Checkpoint chk;
+    chk.Load(sp.checkpointFile);
+    EXPECT_EQ(60, chk.eval);
+    {
+        AsyncSink part(std::unique_ptr<TrajectorySink>(new StatsFileSink(partName, sp.statsFrom)));
+        mdl.SimulTauLeap(sp,part,&chk);
+    }
+    EXPECT_EQ(ReadFile(fullName), ReadFile(partName));
+
+    // A statistics file that is not the one of the checkpoint
+    {
+        std::ofstream os(partName);
+        os << "species\tmean\tvariance\n";
+    }
+    StatsFileSink other(partName, sp.statsFrom);
+    EXPECT_THROW(mdl.SimulTauLeap(sp,other,&chk), std::runtime_error);
+
+    // Without a file the statistics can't be continued
+    StatsSink mem(sp.statsFrom);
+    EXPECT_THROW(mdl.SimulTauLeap(sp,mem,&chk), std::invalid_argument);
+
+    std::remove(fullName.c_str());
+    std::remove(partName.c_str());
+    std::remove(sp.checkpointFile.c_str());
+}
+
+TEST(snimTrajectory, LongFormat){
+    using namespace snim;
+
+    std::string mdlName = "testTrajectory_model.par";
+    {
+        std::ofstream os(mdlName);
+        os << "3 10000\n"
+              "0.1 0.1 0.1\n"
+              "1 1 1\n"
+              "names Predator Prey1 Prey2   # species 1 to 3\n"
+              "0.0 0.0 0.0 0.0\n"
+              "0.0 0.0 3.0 2.0\n"
+              "4.0 0.0 0.0 0.0\n"
+              "2.0 0.0 0.5 0.0\n";
+    }
+    SnimModel mdl;
+    mdl.ReadModelParams(mdlName);
+    std::remove(mdlName.c_str());
+    ASSERT_EQ(4, mdl.GetSpeciesNames().size());
+    EXPECT_EQ("Prey2", mdl.GetSpeciesNames()[3]);
+    EXPECT_EQ(PredatorPrey().Hash(), mdl.Hash());
+
+    SimulationParameters sp = {1234,50,0.01, 1000};
+    sp.recordStart = 10;
+    sp.recordStride = 5;
+    sp.recordSpecies = {1, 3};
+
+    matrix <size_t> out;
+    mdl.SimulTauLeap(sp,out);
+
+    std::string fName = "testTrajectory_long.txt";
+    {
+        LongTsvSink sink(fName, mdl.GetSpeciesNames());
+        mdl.SimulTauLeap(sp,sink);
+    }
+    std::ifstream is(fName);
+    std::string header;
+    std::getline(is, header);
+    EXPECT_EQ("Species\tTime\tDensity", header);
+    for (size_t c = 0; c < out.cols(); ++c)
+        for (size_t r = 0; r < out.rows(); ++r) {
+            std::string species;
+            size_t time = 0, density = 0;
+            ASSERT_TRUE(static_cast<bool>(is >> species >> time >> density));
+            EXPECT_EQ(r == 0 ? "Predator" : "Prey2", species);
+            EXPECT_EQ(10 + 5 * c, time);
+            EXPECT_EQ(out(r,c), density);
+        }
+
+    // Without names and zero densities
+    mdl.SetExtinction(3, 100.0);
+    mdl.SetInmigration(3, 0.0);
+    sp.recordSpecies.clear();
+    mdl.SimulTauLeap(sp,out);
+    size_t nonZero = 0;
+    for (size_t i = 0; i < out.size(); ++i)
+        nonZero += out[i] > 0;
+    ASSERT_LT(nonZero, out.size());
+    {
+        LongTsvSink sink(fName, std::vector<std::string>(), true);
+        mdl.SimulTauLeap(sp,sink);
+    }
+    std::ifstream is2(fName);
+    std::getline(is2, header);
+    size_t lines = 0;
+    std::string species;
+    size_t time = 0, density = 0;
+    while (is2 >> species >> time >> density) {
+        EXPECT_GT(density, 0);
+        EXPECT_EQ(out(std::stoul(species), (time - 10) / 5), density);
+        ++lines;
+    }
+    EXPECT_EQ(nonZero, lines);
+    std::remove(fName.c_str());
+}
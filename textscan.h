@@ -0,0 +1,318 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   textscan.h
+  \brief  Scanning of text files in place: lines, words and numbers are read
+          with pointers into the file or into a block buffer, without strings
+          or streams
+ */
+#ifndef SNIM_TEXTSCAN_HH_
+#define SNIM_TEXTSCAN_HH_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace snim {
+
+/// The characters skipped by operator>> of the streams
+///
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline const char *SkipSpaces(const char *p, const char *end) {
+    while (p < end && IsSpace(*p))
+        ++p;
+    return p;
+}
+
+/// Whether the text has only blanks, the rule of the model and
+/// configuration files for empty lines (a tab is not blank)
+///
+inline bool OnlyBlanks(const char *p, const char *end) {
+    while (p < end && *p == ' ')
+        ++p;
+    return p == end;
+}
+
+/// Next word separated by spaces
+///
+/// \return false if there are only spaces left
+///
+inline bool ScanWord(const char *&p, const char *end, const char *&wBegin, const char *&wEnd) {
+    p = SkipSpaces(p, end);
+    if (p == end)
+        return false;
+    wBegin = p;
+    while (p < end && !IsSpace(*p))
+        ++p;
+    wEnd = p;
+    return true;
+}
+
+/// Read an unsigned integer as operator>> does: spaces, an optional + and
+/// the digits
+///
+/// \return false and p unchanged if there is no number or it overflows
+///
+inline bool ScanUnsigned(const char *&p, const char *end, uint64_t &value) {
+    const char *q = SkipSpaces(p, end);
+    if (q < end && *q == '+')
+        ++q;
+    const char *digits = q;
+    uint64_t v = 0;
+    for (; q < end && *q >= '0' && *q <= '9'; ++q) {
+        uint64_t d = *q - '0';
+        if (v > (std::numeric_limits<uint64_t>::max() - d) / 10)
+            return false;
+        v = v * 10 + d;
+    }
+    if (q == digits)
+        return false;
+    value = v;
+    p = q;
+    return true;
+}
+
+/// Read a signed integer as operator>> does: spaces, an optional sign and
+/// the digits
+///
+/// \return false and p unchanged if there is no number or it overflows
+///
+inline bool ScanSigned(const char *&p, const char *end, int64_t &value) {
+    const char *q = SkipSpaces(p, end);
+    bool negative = q < end && *q == '-';
+    if (negative && (++q == end || *q < '0' || *q > '9'))
+        return false;
+    uint64_t v;
+    if (!ScanUnsigned(q, end, v))
+        return false;
+    uint64_t limit = uint64_t(std::numeric_limits<int64_t>::max()) + (negative ? 1 : 0);
+    if (v > limit)
+        return false;
+    value = negative ? static_cast<int64_t>(0 - v) : static_cast<int64_t>(v);
+    p = q;
+    return true;
+}
+
+/// Read a decimal floating point number with the syntax accepted by
+/// operator>>: optional sign, digits with an optional point and an optional
+/// exponent.
+///
+/// Numbers with up to 19 significant digits and small exponents, that are
+/// the usual in parameter files, are converted with one exact multiplication
+/// or division, so the result is the correctly rounded double as strtod
+/// gives. The rest are copied and passed to strtod.
+///
+/// \return false and p unchanged if there is no number
+///
+inline bool ScanDouble(const char *&p, const char *end, double &value) {
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                   1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                   1e20, 1e21, 1e22};
+
+    const char *start = SkipSpaces(p, end);
+    const char *q = start;
+    bool negative = false;
+    if (q < end && (*q == '+' || *q == '-'))
+        negative = *q++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;                     // Significant digits in mantissa
+    int exp10 = 0;
+    bool any = false, exact = true;
+    for (; q < end && *q >= '0' && *q <= '9'; ++q) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*q - '0');
+            if (mantissa > 0)
+                ++digits;
+        }
+        else {
+            ++exp10;
+            exact = exact && *q == '0';
+        }
+    }
+    if (q < end && *q == '.') {
+        ++q;
+        for (; q < end && *q >= '0' && *q <= '9'; ++q) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*q - '0');
+                if (mantissa > 0)
+                    ++digits;
+                --exp10;
+            }
+            else
+                exact = exact && *q == '0';
+        }
+    }
+    if (!any)
+        return false;
+
+    if (q < end && (*q == 'e' || *q == 'E')) {
+        const char *e = q + 1;
+        bool negExp = false;
+        if (e < end && (*e == '+' || *e == '-'))
+            negExp = *e++ == '-';
+        if (e < end && *e >= '0' && *e <= '9') {
+            int x = 0;
+            for (; e < end && *e >= '0' && *e <= '9'; ++e)
+                if (x < 100000)
+                    x = x * 10 + (*e - '0');
+            exp10 += negExp ? -x : x;
+            q = e;
+        }
+    }
+
+    double v;
+    if (exact && mantissa <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+        v = double(mantissa);
+        v = exp10 < 0 ? v / pow10[-exp10] : v * pow10[exp10];
+    }
+    else {
+        char buf[64];
+        size_t n = q - start;
+        if (n < sizeof(buf)) {
+            std::memcpy(buf, start, n);
+            buf[n] = 0;
+            v = std::strtod(buf, nullptr);
+        }
+        else {
+            std::string tmp(start, q);
+            v = std::strtod(tmp.c_str(), nullptr);
+        }
+        value = v;
+        p = q;
+        return true;
+    }
+    value = negative ? -v : v;
+    p = q;
+    return true;
+}
+
+/**
+  \brief Splits a block of text in lines, with the comments that start with #
+         removed. The text is not copied, lines are pointers into it.
+ */
+class LineScanner {
+    const char *p, *end;
+    size_t lineNo=0;
+
+public:
+    LineScanner(const char *text, size_t len) : p(text), end(text + len) {}
+
+    /// Next line without its comment and end of line
+    ///
+    /// \return false at the end of the text
+    ///
+    bool Next(const char *&lBegin, const char *&lEnd) {
+        if (p == end)
+            return false;
+        lBegin = p;
+        const char *nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char *eol = nl ? nl : end;
+        p = nl ? nl + 1 : end;
+        ++lineNo;
+
+        const char *hash = static_cast<const char*>(std::memchr(lBegin, '#', eol - lBegin));
+        lEnd = hash ? hash : eol;
+        return true;
+    }
+
+    /// Number of the last line returned, from 1
+    ///
+    size_t LineNo() const { return lineNo; }
+};
+
+/**
+  \brief Reads a file in blocks and splits it in lines like LineScanner, so
+         memory does not depend on the size of the file.
+
+  A line is valid until the next call to Next(). The buffer grows to the
+  longest line, one row of a dense model file.
+ */
+class LineReader {
+    std::ifstream is;
+    std::vector<char> buf;
+    size_t pos=0, len=0;                // Bytes not yet returned are buf[pos, len)
+    bool eof=false;
+    size_t lineNo=0;
+
+    void Fill() {
+        std::memmove(buf.data(), buf.data() + pos, len - pos);
+        len -= pos;
+        pos = 0;
+        if (len == buf.size())
+            buf.resize(2 * buf.size());
+        is.read(buf.data() + len, buf.size() - len);
+        len += is.gcount();
+        if (is.gcount() == 0)
+            eof = true;
+    }
+
+public:
+    explicit LineReader(const std::string &fName, size_t blockBytes = 1 << 20) :
+        is(fName, std::ios::binary), buf(blockBytes > 0 ? blockBytes : 1) {}
+
+    bool IsOpen() const { return is.is_open(); }
+
+    /// Next line without its comment and end of line
+    ///
+    /// \return false at the end of the file
+    ///
+    bool Next(const char *&lBegin, const char *&lEnd) {
+        const char *eol;
+        for (;;) {
+            const char *nl = static_cast<const char*>(std::memchr(buf.data() + pos, '\n', len - pos));
+            if (nl) {
+                lBegin = buf.data() + pos;
+                eol = nl;
+                pos = nl - buf.data() + 1;
+                break;
+            }
+            if (eof) {
+                if (pos == len)
+                    return false;
+                lBegin = buf.data() + pos;
+                eol = buf.data() + len;
+                pos = len;
+                break;
+            }
+            Fill();
+        }
+        ++lineNo;
+
+        const char *hash = static_cast<const char*>(std::memchr(lBegin, '#', eol - lBegin));
+        lEnd = hash ? hash : eol;
+        return true;
+    }
+
+    /// Number of the last line returned, from 1
+    ///
+    size_t LineNo() const { return lineNo; }
+};
+
+} /* end namespace */
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   threadpool.h
+  \brief  Fixed size pool of worker threads to run batches of independent jobs
+ */
+#ifndef SNIM_THREADPOOL_HH_
+#define SNIM_THREADPOOL_HH_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "numa.h"
+
+namespace snim {
+
+/**
+  \brief A pool of persistent worker threads.
+
+  Run() hands a batch of jobs numbered 0..nJobs-1 to the workers and blocks
+  until all of them are finished. Each job receives its index and the index of
+  the worker that runs it, so callers can keep one workspace per worker.
+
+  Optionally each worker is pinned to one CPU, interleaving the NUMA nodes.
+  Workspaces should then be allocated and first written inside RunOnEach() so
+  their pages live in the node of the worker that uses them.
+ */
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable cvStart;
+    std::condition_variable cvDone;
+
+    std::function<void(size_t, size_t)> task;
+    std::atomic<size_t> nextJob;
+    size_t nJobs=0;
+    size_t batch=0;                    // Incremented every time a batch starts
+    size_t running=0;                  // Workers still busy with current batch
+    bool onEach=false;                 // Current batch runs once on every worker
+    bool stop=false;
+    std::exception_ptr error;
+
+    bool pinned=false;
+    const NumaTopology &topo;
+    std::atomic<size_t> unpinned;      // Workers whose affinity was refused
+    std::vector<size_t> node;          // NUMA node of each worker
+    std::vector<size_t> jobsDone;      // Jobs finished by each worker
+    double wallTime=0.0;               // Seconds spent inside Run()
+
+    void RunTask(size_t j, size_t w) {
+        try {
+            task(j, w);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!error)
+                error = std::current_exception();
+            nextJob = nJobs;            // Skip the remaining jobs
+        }
+    }
+
+    void WorkerLoop(size_t w) {
+        if (pinned && !topo.PinCurrentThread(w, node[w]))
+            ++unpinned;
+
+        size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cvStart.wait(lock, [&]{ return stop || batch != seen; });
+                if (stop)
+                    return;
+                seen = batch;
+            }
+
+            if (onEach)
+                RunTask(w, w);
+            else
+                for (size_t j = nextJob++; j < nJobs; j = nextJob++) {
+                    RunTask(j, w);
+                    ++jobsDone[w];
+                }
+
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--running == 0)
+                cvDone.notify_all();
+        }
+    }
+
+public:
+    /// Start the workers, nThreads=0 uses the hardware concurrency
+    ///
+    explicit ThreadPool(size_t nThreads=0, bool pin=false) :
+        nextJob(0), pinned(pin), topo(NumaTopology::System()), unpinned(0) {
+        if (nThreads == 0)
+            nThreads = std::thread::hardware_concurrency();
+        if (nThreads == 0)
+            nThreads = 1;
+
+        node.assign(nThreads, 0);
+        jobsDone.assign(nThreads, 0);
+        workers.reserve(nThreads);
+        for (size_t w = 0; w < nThreads; ++w)
+            workers.emplace_back(&ThreadPool::WorkerLoop, this, w);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cvStart.notify_all();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    /// Number of worker threads
+    ///
+    size_t size() const { return workers.size(); }
+
+    /// NUMA node of a worker, always 0 if the pool is not pinned
+    ///
+    size_t NodeOf(size_t worker) const { return node[worker]; }
+
+    /// Run fn(job, worker) for every job in [0,n) and wait for completion.
+    /// The first exception thrown by a job is rethrown here.
+    ///
+    void Run(size_t n, std::function<void(size_t job, size_t worker)> fn) {
+        if (n == 0)
+            return;
+        Start(n, false, std::move(fn));
+    }
+
+    /// Run fn(worker) exactly once in every worker thread, used to allocate
+    /// and first touch per worker workspaces
+    ///
+    void RunOnEach(std::function<void(size_t worker)> fn) {
+        Start(workers.size(), true, [fn](size_t, size_t w){ fn(w); });
+    }
+
+    /// Write the jobs finished and throughput of each NUMA node, and how
+    /// many workers run unpinned
+    ///
+    void Report(std::ostream &os) const {
+        for (size_t n = 0; n < topo.nNodes; ++n) {
+            size_t nWorkers = 0, jobs = 0;
+            for (size_t w = 0; w < workers.size(); ++w)
+                if (node[w] == n) {
+                    ++nWorkers;
+                    jobs += jobsDone[w];
+                }
+            if (nWorkers == 0)
+                continue;
+            os << "Node " << n << ": " << nWorkers << " workers, " << jobs << " jobs, "
+               << (wallTime > 0 ? jobs / wallTime : 0.0) << " jobs/s\n";
+        }
+        if (unpinned > 0)
+            os << unpinned << " workers could not be pinned\n";
+    }
+
+private:
+    void Start(size_t n, bool each, std::function<void(size_t, size_t)> fn) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(mtx);
+        task = std::move(fn);
+        nJobs = n;
+        nextJob = 0;
+        onEach = each;
+        error = nullptr;
+        running = workers.size();
+        ++batch;
+        cvStart.notify_all();
+        cvDone.wait(lock, [&]{ return running == 0; });
+
+        task = nullptr;
+        wallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+} /* end namespace */
+
+#endif
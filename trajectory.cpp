@@ -0,0 +1,285 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include "trajectory.h"
+#include "snim.h"
+#include "stats.h"
+#include "trajfile.h"
+#include "tsvwriter.h"
+
+namespace snim {
+
+TsvStreamSink::TsvStreamSink(const std::string &fName, bool resume) :
+    os(fName, resume ? std::ios::in | std::ios::out | std::ios::binary : std::ios::out | std::ios::binary) {
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+}
+
+void TsvStreamSink::Begin(const TrajectoryInfo &info){
+    nRows = info.nRows;
+}
+
+void TsvStreamSink::Column(size_t col, const size_t *values){
+    (void)col;
+    AppendTsvLine(buf, values, nRows);
+    if (buf.size() >= (1 << 20)) {
+        os.write(buf.data(), buf.size());
+        buf.clear();
+    }
+}
+
+void TsvStreamSink::End(){
+    Sync();
+}
+
+uint64_t TsvStreamSink::Sync(){
+    os.write(buf.data(), buf.size());
+    buf.clear();
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Error writing output file");
+    return os.tellp();
+}
+
+/// The lines after the checkpoint are written again over the ones of the
+/// interrupted run, that are the same
+///
+void TsvStreamSink::Resume(const TrajectoryInfo &info, size_t col, uint64_t size){
+    (void)col;
+    nRows = info.nRows;
+    os.seekp(size);
+    if (!os)
+        throw std::runtime_error("Output file is shorter than the checkpoint");
+}
+
+LongTsvSink::LongTsvSink(const std::string &fName, const std::vector<std::string> &spNames,
+                         bool skipZero, bool resume) :
+    os(fName, resume ? std::ios::in | std::ios::out | std::ios::binary : std::ios::out | std::ios::binary),
+    names(spNames), skipZeros(skipZero) {
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+}
+
+void LongTsvSink::Begin(const TrajectoryInfo &inf){
+    info = inf;
+    rowNames.resize(info.nRows);
+    for (size_t r = 0; r < info.nRows; ++r) {
+        size_t sp = info.species.empty() ? r : info.species[r];
+        if (sp < names.size())
+            rowNames[r] = names[sp];
+        else
+            rowNames[r] = std::to_string(sp);
+        rowNames[r] += '\t';
+    }
+    os << "Species\tTime\tDensity\n";
+}
+
+void LongTsvSink::Column(size_t col, const size_t *values){
+    char time[maxDigits + 1];
+    char *end = FormatUnsigned(time, info.firstEval + col * info.evalStride);
+    *end++ = '\t';
+
+    for (size_t r = 0; r < info.nRows; ++r) {
+        if (skipZeros && values[r] == 0)
+            continue;
+        buf.insert(buf.end(), rowNames[r].begin(), rowNames[r].end());
+        buf.insert(buf.end(), time, end);
+        size_t pos = buf.size();
+        buf.resize(pos + maxDigits + 1);
+        char *p = FormatUnsigned(&buf[pos], values[r]);
+        *p++ = '\n';
+        buf.resize(p - buf.data());
+    }
+    if (buf.size() >= (1 << 20)) {
+        os.write(buf.data(), buf.size());
+        buf.clear();
+    }
+}
+
+void LongTsvSink::End(){
+    Sync();
+}
+
+uint64_t LongTsvSink::Sync(){
+    os.write(buf.data(), buf.size());
+    buf.clear();
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Error writing output file");
+    return os.tellp();
+}
+
+void LongTsvSink::Resume(const TrajectoryInfo &inf, size_t col, uint64_t size){
+    (void)col;
+    Begin(inf);                         // Writes the same header over the old one
+    os.seekp(size);
+    if (!os)
+        throw std::runtime_error("Output file is shorter than the checkpoint");
+}
+
+void TsvMatrixSink::End(){
+    std::ofstream os(fName);
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+    WriteTsv(os, N);
+    if (!os)
+        throw std::runtime_error("Error writing output file " + fName);
+}
+
+AsyncSink::~AsyncSink(){
+    Stop();
+}
+
+void AsyncSink::Begin(const TrajectoryInfo &info){
+    sink->Begin(info);
+    Start(info);
+}
+
+void AsyncSink::Resume(const TrajectoryInfo &info, size_t col, uint64_t size){
+    sink->Resume(info, col, size);
+    Start(info);
+}
+
+void AsyncSink::Start(const TrajectoryInfo &info){
+    nRows = info.nRows;
+    batchCols = std::max<size_t>(1, bufferBytes / (nRows * sizeof(size_t)));
+    fill.resize(batchCols * nRows);
+    drain.resize(batchCols * nRows);
+    fillCount = 0;
+
+    writer = std::thread(&AsyncSink::Writer, this);
+}
+
+void AsyncSink::Column(size_t col, const size_t *values){
+    if (fillCount == 0)
+        fillFirst = col;
+    std::copy(values, values + nRows, fill.begin() + fillCount * nRows);
+    if (++fillCount == batchCols)
+        Handover();
+}
+
+/// Give the filled buffer to the writer, waiting until it is done with the
+/// other one
+///
+void AsyncSink::Handover(){
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this]{ return !busy; });
+    if (error)
+        std::rethrow_exception(error);
+
+    fill.swap(drain);
+    drainFirst = fillFirst;
+    drainCount = fillCount;
+    fillCount = 0;
+    busy = true;
+    cv.notify_all();
+}
+
+/// Wait until the writer has passed all the columns to the sink
+///
+void AsyncSink::Drain(){
+    if (fillCount > 0)
+        Handover();
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this]{ return !busy; });
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/// The writer is idle after Drain(), so the sink is used from this thread
+///
+uint64_t AsyncSink::Sync(){
+    Drain();
+    return sink->Sync();
+}
+
+void AsyncSink::Writer(){
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this]{ return busy || done; });
+            if (!busy)
+                return;
+        }
+
+        try {
+            if (!error)
+                for (size_t c = 0; c < drainCount; ++c)
+                    sink->Column(drainFirst + c, drain.data() + c * nRows);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        busy = false;
+        cv.notify_all();
+    }
+}
+
+/// Wait for the writer to drain its buffer and end the thread
+///
+void AsyncSink::Stop(){
+    if (!writer.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        done = true;
+        cv.notify_all();
+    }
+    writer.join();
+}
+
+void AsyncSink::End(){
+    if (fillCount > 0)
+        Handover();
+    Stop();
+    if (error)
+        std::rethrow_exception(error);
+    sink->End();
+}
+
+std::unique_ptr<TrajectorySink> MakeFileSink(const std::string &format, const std::string &fName,
+                                             uint64_t modelHash, bool resume){
+    if (format == "tsv") {
+        if (resume)
+            throw std::invalid_argument("The tsv output format can't continue from a checkpoint, use stream");
+        return std::unique_ptr<TrajectorySink>(new TsvMatrixSink(fName));
+    }
+    if (format == "stream")
+        return std::unique_ptr<TrajectorySink>(new TsvStreamSink(fName, resume));
+    if (format == "binary")
+        return std::unique_ptr<TrajectorySink>(new BinaryTrajectorySink(fName, modelHash, TrajRaw, resume));
+    if (format == "sparse")
+        return std::unique_ptr<TrajectorySink>(new BinaryTrajectorySink(fName, modelHash, TrajSparse, resume));
+    if (format == "compressed")
+        return std::unique_ptr<TrajectorySink>(new BinaryTrajectorySink(fName, modelHash, TrajDelta, resume));
+
+    throw std::invalid_argument("Unknown output format [" + format + "]");
+}
+
+std::unique_ptr<TrajectorySink> MakeOutputSink(const SnimModel &mdl, const SimulationParameters &sp,
+                                               const std::string &fName, bool resume){
+    if (sp.outputFormat == "stats")
+        return std::unique_ptr<TrajectorySink>(new StatsFileSink(fName, sp.statsFrom));
+    if (sp.outputFormat == "long")
+        return std::unique_ptr<TrajectorySink>(new LongTsvSink(fName, mdl.GetSpeciesNames(), sp.skipZeros, resume));
+    return MakeFileSink(sp.outputFormat, fName, mdl.Hash(), resume);
+}
+
+} // end namespace
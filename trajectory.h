@@ -0,0 +1,260 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   trajectory.h
+  \brief  Receivers of the simulated trajectories, in memory or streamed to files
+ */
+#ifndef SNIM_TRAJECTORY_HH_
+#define SNIM_TRAJECTORY_HH_
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "matrix.h"
+
+namespace snim {
+
+/**
+  \brief Description of a trajectory given to the sink before the first column
+ */
+struct TrajectoryInfo {
+    size_t nRows=0;                     /// Species recorded, all of them plus the empty space by default
+    size_t nCols=0;                     /// Evaluations recorded, all of them plus the initial conditions by default
+    size_t seed=0;                      /// Seed actually used by the random generator
+    size_t maxCount=0;                  /// Upper bound of the counts: the community size
+    std::vector<size_t> species;        /// Species of each row, empty if row r is species r
+    size_t firstEval=0;                 /// Evaluation of the first column
+    size_t evalStride=1;                /// Evaluations between columns
+};
+
+/**
+  \brief Interface that receives each evaluation of a simulation as soon as it
+         is produced.
+
+  The simulation calls Begin() once, then Column() for the initial
+  conditions and every evaluation in order, and finally End(). A column
+  holds the number of individuals of species 0 (empty space) to nSpecies.
+  When SimulationParameters limits the recording only the selected
+  evaluations and species are passed.
+ */
+class TrajectorySink {
+public:
+    virtual ~TrajectorySink() {}
+
+    virtual void Begin(const TrajectoryInfo &info) { (void)info; }
+
+    /// \param col number of the column recorded, by default the evaluation
+    ///            with 0 the initial conditions
+    /// \param values info.nRows values valid only during the call
+    ///
+    virtual void Column(size_t col, const size_t *values) = 0;
+
+    virtual void End() {}
+
+    /// Write everything received so far, called when a checkpoint is saved
+    ///
+    /// \return size of the output, to continue it from there
+    ///
+    virtual uint64_t Sync() { return 0; }
+
+    /// Called instead of Begin() when a simulation continues from a
+    /// checkpoint, the next column will be col
+    ///
+    /// \param size value of Sync() at the checkpoint
+    ///
+    virtual void Resume(const TrajectoryInfo &info, size_t col, uint64_t size) {
+        (void)info; (void)col; (void)size;
+        throw std::invalid_argument("This output format can't continue from a checkpoint");
+    }
+};
+
+/**
+  \brief Stores the whole trajectory in a matrix, species by evaluations
+ */
+class MatrixSink : public TrajectorySink {
+    matrix<size_t> &N;
+
+public:
+    explicit MatrixSink(matrix<size_t> &out) : N(out) {}
+
+    void Begin(const TrajectoryInfo &info) override {
+        if (N.rows() != info.nRows || N.cols() != info.nCols)
+            N.resize(info.nRows, info.nCols);
+    }
+
+    void Column(size_t col, const size_t *values) override {
+        std::memcpy(N.data() + col * N.rows(), values, N.rows() * sizeof(size_t));
+    }
+};
+
+/**
+  \brief Writes each evaluation as a tab separated line as soon as it is
+         produced, memory does not depend on the number of evaluations.
+
+  The layout is transposed with respect to the matrix output: one line for
+  each evaluation and one column for each species.
+ */
+class TsvStreamSink : public TrajectorySink {
+    std::ofstream os;
+    size_t nRows=0;
+    std::vector<char> buf;              // Lines not yet written
+
+public:
+    /// \param fName output file name
+    /// \param resume open the file without truncating it, to Resume() it
+    ///
+    explicit TsvStreamSink(const std::string &fName, bool resume=false);
+
+    void Begin(const TrajectoryInfo &info) override;
+    void Column(size_t col, const size_t *values) override;
+    void End() override;
+    uint64_t Sync() override;
+    void Resume(const TrajectoryInfo &info, size_t col, uint64_t size) override;
+};
+
+/**
+  \brief Writes the trajectory in long format, one line for each species and
+         evaluation: Species, Time and Density, the layout of run_snim in R.
+
+  Species are named by their number or by the names of the model, and lines
+  with zero density can be left out.
+ */
+class LongTsvSink : public TrajectorySink {
+    std::ofstream os;
+    std::vector<std::string> names;     // Name of each species, 0 is the empty space
+    bool skipZeros;
+    TrajectoryInfo info;
+    std::vector<std::string> rowNames;  // Name of each row followed by a tab
+    std::vector<char> buf;
+
+public:
+    /// \param fName output file name
+    /// \param spNames names of the species from 0, numbers are used if empty
+    /// \param skipZero leave out the lines with zero density
+    /// \param resume open the file without truncating it, to Resume() it
+    ///
+    LongTsvSink(const std::string &fName, const std::vector<std::string> &spNames,
+                bool skipZero=false, bool resume=false);
+
+    void Begin(const TrajectoryInfo &info) override;
+    void Column(size_t col, const size_t *values) override;
+    void End() override;
+    uint64_t Sync() override;
+    void Resume(const TrajectoryInfo &info, size_t col, uint64_t size) override;
+};
+
+/**
+  \brief Keeps the trajectory in a matrix and writes it at the end with the
+         original layout, one line for each species
+ */
+class TsvMatrixSink : public TrajectorySink {
+    std::string fName;
+    matrix<size_t> N;
+    MatrixSink mem;
+
+public:
+    explicit TsvMatrixSink(const std::string &name) : fName(name), N(), mem(N) {}
+
+    void Begin(const TrajectoryInfo &info) override { mem.Begin(info); }
+    void Column(size_t col, const size_t *values) override { mem.Column(col, values); }
+    void End() override;
+};
+
+/**
+  \brief Passes the columns to another sink from a background thread, so the
+         formatting and writing of the output overlap with the simulation.
+
+  Columns are copied to one of two buffers while the writer thread drains the
+  other. When the buffer being filled is full and the writer has not finished
+  the previous one the simulation waits, so memory stays bounded if the disk
+  is slower than the simulation. Errors of the inner sink are thrown by the
+  next Column() or by End().
+ */
+class AsyncSink : public TrajectorySink {
+    std::unique_ptr<TrajectorySink> sink;
+    size_t bufferBytes;
+    size_t nRows=0;
+    size_t batchCols=0;                 // Columns of each buffer
+
+    std::vector<size_t> fill, drain;    // Filled by the simulation, drained by the writer
+    size_t fillFirst=0, fillCount=0;
+    size_t drainFirst=0, drainCount=0;
+
+    std::thread writer;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool busy=false;                    // The writer has a buffer to drain
+    bool done=false;
+    std::exception_ptr error;
+
+    void Writer();
+    void Handover();
+    void Drain();
+    void Stop();
+    void Start(const TrajectoryInfo &info);
+
+public:
+    /// \param inner sink that receives the columns in the writer thread
+    /// \param bytes size of each of the two buffers
+    ///
+    explicit AsyncSink(std::unique_ptr<TrajectorySink> inner, size_t bytes = 1 << 20) :
+        sink(std::move(inner)), bufferBytes(bytes) {}
+
+    ~AsyncSink();
+
+    void Begin(const TrajectoryInfo &info) override;
+    void Column(size_t col, const size_t *values) override;
+    void End() override;
+    uint64_t Sync() override;
+    void Resume(const TrajectoryInfo &info, size_t col, uint64_t size) override;
+};
+
+/// Create the file sink for an output format
+///
+/// \param format tsv (one line per species, needs the whole trajectory in
+///               memory), stream (one line per evaluation), binary
+///               (columnar format of trajfile.h), sparse (binary with
+///               only the species present) or compressed (binary with the
+///               differences between evaluations)
+/// \param fName  output file name
+/// \param modelHash stored in the binary header
+/// \param resume    open an existing output to continue it from a checkpoint
+///
+std::unique_ptr<TrajectorySink> MakeFileSink(const std::string &format, const std::string &fName,
+                                             uint64_t modelHash=0, bool resume=false);
+
+class SnimModel;
+struct SimulationParameters;
+
+/// Sink of the output file for the format of the simulation parameters:
+/// stats, long or the formats of MakeFileSink
+///
+std::unique_ptr<TrajectorySink> MakeOutputSink(const SnimModel &mdl, const SimulationParameters &sp,
+                                               const std::string &fName, bool resume=false);
+
+} /* end namespace */
+
+#endif
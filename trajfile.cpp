@@ -0,0 +1,495 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "trajfile.h"
+#include "tsvwriter.h"
+
+namespace snim {
+
+static const char trajMagic[8] = {'S','N','I','M','T','R','J','\0'};
+static const uint32_t trajVersion = 2;
+static const uint32_t trajEndianTag = 0x01020304;
+static const size_t trajBlockBytes = 1 << 20;
+
+static size_t Padding(size_t bytes) {
+    return (8 - bytes % 8) % 8;
+}
+
+template<typename T>
+static void Append(std::vector<char> &buf, T v) {
+    size_t pos = buf.size();
+    buf.resize(pos + sizeof(T));
+    std::memcpy(&buf[pos], &v, sizeof(T));
+}
+
+template<typename T>
+static T Load(const char *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+/// Signed differences are mapped to unsigned so small magnitudes of both signs
+/// give small numbers: 0, -1, 1, -2, 2 ... become 0, 1, 2, 3, 4 ...
+///
+static uint64_t ZigZag(int64_t d) {
+    return (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63);
+}
+
+static int64_t UnZigZag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+/// Seven bits per byte, the high bit tells that more bytes follow
+///
+static void PutVarint(std::vector<char> &buf, uint64_t v) {
+    while (v >= 0x80) {
+        buf.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    buf.push_back(static_cast<char>(v));
+}
+
+static uint64_t GetVarint(const char *&p, const char *end) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end)
+            break;
+        uint8_t b = static_cast<uint8_t>(*p++);
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    throw std::runtime_error("Corrupted delta block in trajectory file");
+}
+
+BinaryTrajectorySink::BinaryTrajectorySink(const std::string &fName, uint64_t modelHash, TrajEncoding enc,
+                                           bool resume) :
+    os(fName, resume ? std::ios::in | std::ios::out | std::ios::binary : std::ios::out | std::ios::binary),
+    fName(fName), encoding(enc) {
+    if (!os)
+        throw std::runtime_error("Can't open output file " + fName);
+
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, trajMagic, sizeof(trajMagic));
+    hdr.version = trajVersion;
+    hdr.modelHash = modelHash;
+    hdr.endianTag = trajEndianTag;
+    std::memset(&layout, 0, sizeof(layout));
+}
+
+/// Counts are stored in 4 bytes when the community size allows it
+///
+void BinaryTrajectorySink::Begin(const TrajectoryInfo &info){
+    hdr.countBytes = info.maxCount < (uint64_t(1) << 32) ? 4 : 8;
+    hdr.nRows = info.nRows;
+    hdr.nCols = 0;
+    hdr.seed = info.seed;
+    hdr.blockCols = std::max<size_t>(1, trajBlockBytes / (info.nRows * hdr.countBytes));
+
+    species.assign(info.species.begin(), info.species.end());
+    layout.firstEval = info.firstEval;
+    layout.evalStride = info.evalStride;
+    layout.nSpecies = species.size();
+
+    os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    os.write(reinterpret_cast<const char*>(&layout), sizeof(layout));
+    os.write(reinterpret_cast<const char*>(species.data()), species.size() * sizeof(uint64_t));
+    if (encoding == TrajDelta)
+        pending.reserve(hdr.blockCols * hdr.nRows);
+    else
+        block.reserve(hdr.blockCols * hdr.nRows * hdr.countBytes);
+}
+
+void BinaryTrajectorySink::Column(size_t col, const size_t *values){
+    if (blockCount == 0)
+        blockFirst = col;
+
+    if (encoding == TrajSparse)
+        AppendSparse(values);
+    else if (encoding == TrajDelta)
+        pending.insert(pending.end(), values, values + hdr.nRows);
+    else
+        AppendRaw(values);
+
+    ++hdr.nCols;
+    if (++blockCount == hdr.blockCols || block.size() >= trajBlockBytes)
+        FlushBlock();
+}
+
+void BinaryTrajectorySink::AppendRaw(const size_t *values){
+    size_t pos = block.size();
+    block.resize(pos + hdr.nRows * hdr.countBytes);
+    char *p = &block[pos];
+    if (hdr.countBytes == 4)
+        for (size_t r = 0; r < hdr.nRows; ++r) {
+            uint32_t v = static_cast<uint32_t>(values[r]);
+            std::memcpy(p + r * 4, &v, 4);
+        }
+    else
+        for (size_t r = 0; r < hdr.nRows; ++r) {
+            uint64_t v = values[r];
+            std::memcpy(p + r * 8, &v, 8);
+        }
+}
+
+/// Only the non zero counts are stored, first their rows then their values
+///
+void BinaryTrajectorySink::AppendSparse(const size_t *values){
+    size_t nzPos = block.size();
+    Append<uint32_t>(block, 0);
+
+    uint32_t nnz = 0;
+    for (size_t r = 0; r < hdr.nRows; ++r)
+        if (values[r] != 0) {
+            Append<uint32_t>(block, r);
+            ++nnz;
+        }
+    for (size_t r = 0; r < hdr.nRows; ++r)
+        if (values[r] != 0) {
+            if (hdr.countBytes == 4)
+                Append<uint32_t>(block, values[r]);
+            else
+                Append<uint64_t>(block, values[r]);
+        }
+    std::memcpy(&block[nzPos], &nnz, sizeof(nnz));
+}
+
+/// The payload starts with the offset of each row series, relative to the end
+/// of the offsets, so one species can be decoded without the others
+///
+void BinaryTrajectorySink::EncodeDelta(){
+    block.assign(hdr.nRows * sizeof(uint32_t), 0);
+    size_t start = block.size();
+    for (size_t r = 0; r < hdr.nRows; ++r) {
+        uint32_t off = block.size() - start;
+        std::memcpy(&block[r * sizeof(uint32_t)], &off, sizeof(off));
+
+        size_t prev = 0;
+        for (size_t c = 0; c < blockCount; ++c) {
+            size_t v = pending[c * hdr.nRows + r];
+            PutVarint(block, ZigZag(static_cast<int64_t>(v - prev)));
+            prev = v;
+        }
+    }
+    pending.clear();
+}
+
+void BinaryTrajectorySink::FlushBlock(){
+    if (blockCount == 0)
+        return;
+    if (encoding == TrajDelta)
+        EncodeDelta();
+
+    TrajBlockHeader bh;
+    bh.firstCol = blockFirst;
+    bh.nCols = blockCount;
+    bh.encoding = encoding;
+    bh.payloadBytes = block.size();
+    os.write(reinterpret_cast<const char*>(&bh), sizeof(bh));
+    os.write(block.data(), block.size());
+
+    static const char zeros[8] = {0};
+    os.write(zeros, Padding(block.size()));
+
+    block.clear();
+    blockCount = 0;
+}
+
+uint64_t BinaryTrajectorySink::Sync(){
+    FlushBlock();
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Error writing binary trajectory file");
+    return os.tellp();
+}
+
+/// The header of the interrupted run is kept and the blocks after the
+/// checkpoint are written again
+///
+void BinaryTrajectorySink::Resume(const TrajectoryInfo &info, size_t col, uint64_t size){
+    std::ifstream is(fName, std::ios::binary);
+    TrajFileHeader old;
+    is.read(reinterpret_cast<char*>(&old), sizeof(old));
+    if (!is || std::memcmp(old.magic, trajMagic, sizeof(trajMagic)) != 0)
+        throw std::runtime_error("File [" + fName + "] is not a trajectory file");
+    if (old.nRows != info.nRows)
+        throw std::runtime_error("File [" + fName + "] has a different number of species");
+
+    hdr.version = old.version;
+    hdr.countBytes = old.countBytes;
+    hdr.nRows = old.nRows;
+    hdr.nCols = col;
+    hdr.seed = old.seed;
+    hdr.blockCols = old.blockCols;
+
+    os.seekp(size);
+    if (!os)
+        throw std::runtime_error("File [" + fName + "] is shorter than the checkpoint");
+    if (encoding == TrajDelta)
+        pending.reserve(hdr.blockCols * hdr.nRows);
+    else
+        block.reserve(hdr.blockCols * hdr.nRows * hdr.countBytes);
+}
+
+/// Write the last block and the final number of columns in the header
+///
+void BinaryTrajectorySink::End(){
+    FlushBlock();
+    os.seekp(0);
+    os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Error writing binary trajectory file");
+}
+
+
+TrajectoryFile::TrajectoryFile(const std::string &fName) : file(fName) {
+    if (file.size() < sizeof(hdr))
+        throw std::runtime_error("File [" + fName + "] is not a trajectory file");
+
+    std::memcpy(&hdr, file.data(), sizeof(hdr));
+    if (std::memcmp(hdr.magic, trajMagic, sizeof(trajMagic)) != 0)
+        throw std::runtime_error("File [" + fName + "] is not a trajectory file");
+    if (hdr.endianTag != trajEndianTag)
+        throw std::runtime_error("File [" + fName + "] was written with another byte order");
+    if (hdr.version > trajVersion)
+        throw std::runtime_error("File [" + fName + "] has an unknown version");
+    if (hdr.countBytes != 4 && hdr.countBytes != 8)
+        throw std::runtime_error("File [" + fName + "] is not a trajectory file");
+
+    size_t pos = sizeof(hdr);
+    layout.firstEval = 0;
+    layout.evalStride = 1;
+    layout.nSpecies = 0;
+    if (hdr.version >= 2) {
+        if (pos + sizeof(layout) > file.size())
+            throw std::runtime_error("File [" + fName + "] is not a trajectory file");
+        std::memcpy(&layout, file.data() + pos, sizeof(layout));
+        pos += sizeof(layout);
+        if ((layout.nSpecies != 0 && layout.nSpecies != hdr.nRows) ||
+            pos + layout.nSpecies * sizeof(uint64_t) > file.size())
+            throw std::runtime_error("File [" + fName + "] has a corrupted species list");
+        for (uint64_t r = 0; r < layout.nSpecies; ++r)
+            species.push_back(Load<uint64_t>(file.data() + pos + r * sizeof(uint64_t)));
+        pos += layout.nSpecies * sizeof(uint64_t);
+    }
+
+    // Index the blocks, an incomplete block at the end (an interrupted run)
+    // is ignored
+    //
+    while (pos + sizeof(TrajBlockHeader) <= file.size()) {
+        TrajBlockHeader bh;
+        std::memcpy(&bh, file.data() + pos, sizeof(bh));
+        pos += sizeof(bh);
+        if (pos + bh.payloadBytes > file.size())
+            break;
+
+        Block b = {bh.firstCol, bh.nCols, bh.encoding, file.data() + pos, bh.payloadBytes, {}};
+        if (b.firstCol != nCols)
+            throw std::runtime_error("File [" + fName + "] has blocks out of order");
+
+        if (b.encoding == TrajRaw && b.bytes != uint64_t(b.nCols) * hdr.nRows * hdr.countBytes)
+            throw std::runtime_error("File [" + fName + "] has a corrupted raw block");
+        else if (b.encoding == TrajSparse) {
+            uint64_t off = 0;
+            for (uint32_t c = 0; c < b.nCols; ++c) {
+                if (off + 4 > b.bytes)
+                    throw std::runtime_error("File [" + fName + "] has a corrupted sparse block");
+                uint32_t nnz = Load<uint32_t>(b.payload + off);
+                if (nnz > hdr.nRows || off + 4 + uint64_t(nnz) * (4 + hdr.countBytes) > b.bytes)
+                    throw std::runtime_error("File [" + fName + "] has a corrupted sparse block");
+                b.colOffset.push_back(off);
+                off += 4 + uint64_t(nnz) * (4 + hdr.countBytes);
+            }
+        }
+        else if (b.encoding == TrajDelta && b.bytes < hdr.nRows * sizeof(uint32_t))
+            throw std::runtime_error("File [" + fName + "] has a corrupted delta block");
+        blocks.push_back(std::move(b));
+        nCols += bh.nCols;
+        pos += bh.payloadBytes + Padding(bh.payloadBytes);
+    }
+}
+
+void TrajectoryFile::DecodeRow(const Block &b, size_t row, size_t *out) const {
+    const char *series = b.payload + hdr.nRows * sizeof(uint32_t);
+    const char *end = b.payload + b.bytes;
+    uint32_t off = Load<uint32_t>(b.payload + row * sizeof(uint32_t));
+    if (off > end - series)
+        throw std::runtime_error("Corrupted delta block in trajectory file");
+    const char *p = series + off;
+
+    size_t v = 0;
+    for (uint32_t c = 0; c < b.nCols; ++c) {
+        v += static_cast<size_t>(UnZigZag(GetVarint(p, end)));
+        out[c] = v;
+    }
+}
+
+/// Counts of a whole delta block, column-major like the raw blocks
+///
+const size_t *TrajectoryFile::Decoded(const Block &b) const {
+    if (cached == &b)
+        return cache.data();
+
+    cache.resize(size_t(b.nCols) * hdr.nRows);
+    std::vector<size_t> series(b.nCols);
+    for (size_t r = 0; r < hdr.nRows; ++r) {
+        DecodeRow(b, r, series.data());
+        for (uint32_t c = 0; c < b.nCols; ++c)
+            cache[c * hdr.nRows + r] = series[c];
+    }
+    cached = &b;
+    return cache.data();
+}
+
+const TrajectoryFile::Block &TrajectoryFile::BlockOf(size_t col) const {
+    if (col >= nCols)
+        throw std::out_of_range("Trajectory column out of range");
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), col,
+                               [](size_t c, const Block &b){ return c < b.firstCol; });
+    return *(it - 1);
+}
+
+const void *TrajectoryFile::RawColumn(size_t col) const {
+    auto const &b = BlockOf(col);
+    if (b.encoding != TrajRaw)
+        return nullptr;
+    return b.payload + (col - b.firstCol) * hdr.nRows * hdr.countBytes;
+}
+
+void TrajectoryFile::ReadColumn(size_t col, size_t *out) const {
+    auto const &b = BlockOf(col);
+    switch (b.encoding) {
+        case TrajRaw: {
+            const char *p = b.payload + (col - b.firstCol) * hdr.nRows * hdr.countBytes;
+            if (hdr.countBytes == 4)
+                for (size_t r = 0; r < hdr.nRows; ++r) {
+                    uint32_t v;
+                    std::memcpy(&v, p + r * 4, 4);
+                    out[r] = v;
+                }
+            else
+                for (size_t r = 0; r < hdr.nRows; ++r) {
+                    uint64_t v;
+                    std::memcpy(&v, p + r * 8, 8);
+                    out[r] = v;
+                }
+            break;
+        }
+        case TrajSparse: {
+            const char *p = b.payload + b.colOffset[col - b.firstCol];
+            uint32_t nnz = Load<uint32_t>(p);
+            const char *rows = p + 4;
+            const char *vals = rows + 4 * nnz;
+            std::fill(out, out + hdr.nRows, 0);
+            for (uint32_t i = 0; i < nnz; ++i) {
+                uint32_t r = Load<uint32_t>(rows + 4 * i);
+                if (r >= hdr.nRows)
+                    throw std::runtime_error("Corrupted sparse block in trajectory file");
+                out[r] = hdr.countBytes == 4 ? Load<uint32_t>(vals + 4 * i) : Load<uint64_t>(vals + 8 * i);
+            }
+            break;
+        }
+        case TrajDelta: {
+            const size_t *p = Decoded(b) + (col - b.firstCol) * hdr.nRows;
+            std::copy(p, p + hdr.nRows, out);
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown block encoding in trajectory file");
+    }
+}
+
+size_t TrajectoryFile::Value(size_t row, size_t col) const {
+    if (row >= hdr.nRows)
+        throw std::out_of_range("Trajectory row out of range");
+
+    auto const &b = BlockOf(col);
+    switch (b.encoding) {
+        case TrajRaw: {
+            const char *p = b.payload + ((col - b.firstCol) * hdr.nRows + row) * hdr.countBytes;
+            return hdr.countBytes == 4 ? Load<uint32_t>(p) : Load<uint64_t>(p);
+        }
+        case TrajSparse: {
+            // Rows are sorted, binary search the species in the column
+            const char *p = b.payload + b.colOffset[col - b.firstCol];
+            uint32_t nnz = Load<uint32_t>(p);
+            const char *rows = p + 4;
+            uint32_t lo = 0, hi = nnz;
+            while (lo < hi) {
+                uint32_t mid = (lo + hi) / 2;
+                if (Load<uint32_t>(rows + 4 * mid) < row)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo == nnz || Load<uint32_t>(rows + 4 * lo) != row)
+                return 0;
+            const char *vals = rows + 4 * nnz;
+            return hdr.countBytes == 4 ? Load<uint32_t>(vals + 4 * lo) : Load<uint64_t>(vals + 8 * lo);
+        }
+        default: {
+            std::vector<size_t> c(hdr.nRows);
+            ReadColumn(col, c.data());
+            return c[row];
+        }
+    }
+}
+
+std::vector<size_t> TrajectoryFile::Series(size_t row) const {
+    if (row >= hdr.nRows)
+        throw std::out_of_range("Trajectory row out of range");
+
+    std::vector<size_t> s(nCols);
+    for (auto const &b : blocks) {
+        if (b.encoding == TrajDelta)
+            DecodeRow(b, row, &s[b.firstCol]);
+        else
+            for (size_t c = b.firstCol; c < b.firstCol + b.nCols; ++c)
+                s[c] = Value(row, c);
+    }
+    return s;
+}
+
+void TrajectoryFile::WriteTsv(std::ostream &os) const {
+    bool labels = !species.empty() || layout.firstEval != 0 || layout.evalStride != 1;
+    if (labels) {
+        os << "Species";
+        for (size_t c = 0; c < nCols; ++c)
+            os << '\t' << EvalOf(c);
+        os << '\n';
+    }
+
+    std::vector<char> buf;
+    char label[maxDigits + 1];
+    for (size_t r = 0; r < hdr.nRows; ++r) {
+        auto s = Series(r);
+        buf.clear();
+        if (labels) {
+            char *end = FormatUnsigned(label, SpeciesOf(r));
+            *end++ = '\t';
+            buf.insert(buf.end(), label, end);
+        }
+        AppendTsvLine(buf, s.data(), s.size());
+        os.write(buf.data(), buf.size());
+    }
+}
+
+} // end namespace
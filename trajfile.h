@@ -0,0 +1,210 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   trajfile.h
+  \brief  Binary columnar trajectory files: writer sink and memory mapped reader
+ */
+#ifndef SNIM_TRAJFILE_HH_
+#define SNIM_TRAJFILE_HH_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "trajectory.h"
+#include "mappedfile.h"
+
+namespace snim {
+
+/**
+  \brief Fixed header at the start of a binary trajectory file.
+
+  The file is written in the byte order of the host, endianTag tells the
+  reader if it matches. From version 2 the header is followed by a
+  TrajFileLayout. Then come blocks of consecutive columns, each with a
+  TrajBlockHeader followed by its payload padded to 8 bytes.
+ */
+struct TrajFileHeader {
+    char magic[8];                      /// "SNIMTRJ" and a zero
+    uint32_t version;
+    uint32_t countBytes;                /// 4 or 8 bytes per count
+    uint64_t nRows;                     /// Species plus the empty space
+    uint64_t nCols;                     /// Evaluations written, including the initial conditions
+    uint64_t seed;                      /// Seed of the random generator
+    uint64_t modelHash;                 /// SnimModel::Hash() of the model simulated
+    uint64_t blockCols;                 /// Maximum number of columns of a block
+    uint32_t endianTag;                 /// 0x01020304
+    uint32_t reserved;
+};
+
+/**
+  \brief Rows and columns recorded, written after the header from version 2
+         followed by nSpecies uint64 with the species of each row.
+
+  nSpecies is 0 when row r is species r. Version 1 files have no layout and
+  are read as all the species and all the evaluations.
+ */
+struct TrajFileLayout {
+    uint64_t firstEval;                 /// Evaluation of the first column
+    uint64_t evalStride;                /// Evaluations between columns
+    uint64_t nSpecies;                  /// 0 or nRows
+};
+
+struct TrajBlockHeader {
+    uint64_t firstCol;
+    uint32_t nCols;
+    uint32_t encoding;                  /// TrajEncoding of the payload
+    uint64_t payloadBytes;
+};
+
+enum TrajEncoding : uint32_t {
+    TrajRaw = 0,                        /// Column-major counts of countBytes each
+    TrajSparse = 1,                     /// For each column: uint32 nnz, nnz uint32 rows, nnz counts
+    TrajDelta = 2                       /// For each row: the start of its series as uint32, then the
+                                        /// series as zig-zag varints of the differences between columns
+};
+
+/**
+  \brief Writes the trajectory in the binary columnar format, columns are
+         collected in blocks of about 1 MB that are written when full.
+
+  With the sparse encoding only the species present are stored, so the size
+  of the file is proportional to the richness instead of the species pool.
+  With the delta encoding the columns of a block are kept until it is full
+  and each species is stored as the differences between evaluations, that
+  are small and take one or two bytes. The first difference of a block is
+  taken from zero so each block can be decoded alone.
+ */
+class BinaryTrajectorySink : public TrajectorySink {
+    std::ofstream os;
+    std::string fName;
+    TrajFileHeader hdr;
+    TrajFileLayout layout;
+    std::vector<uint64_t> species;      // Species of each row, empty if row r is species r
+    TrajEncoding encoding;
+    std::vector<char> block;            // Payload of the current block
+    std::vector<size_t> pending;        // Columns of the current block for the delta encoding
+    uint64_t blockFirst=0;
+    uint32_t blockCount=0;
+
+    void FlushBlock();
+    void AppendRaw(const size_t *values);
+    void AppendSparse(const size_t *values);
+    void EncodeDelta();
+
+public:
+    /// \param fName output file name
+    /// \param modelHash hash of the model, stored in the header
+    /// \param enc encoding of the blocks
+    /// \param resume open the file without truncating it, to Resume() it
+    ///
+    BinaryTrajectorySink(const std::string &fName, uint64_t modelHash=0, TrajEncoding enc=TrajRaw,
+                         bool resume=false);
+
+    void Begin(const TrajectoryInfo &info) override;
+    void Column(size_t col, const size_t *values) override;
+    void End() override;
+
+    /// Write the current block, even if it is not full
+    ///
+    uint64_t Sync() override;
+    void Resume(const TrajectoryInfo &info, size_t col, uint64_t size) override;
+};
+
+/**
+  \brief Read access to a binary trajectory file without copying it: the file
+         is memory mapped and raw blocks are used in place
+
+  Delta blocks are decoded whole and the last one is kept, so reading the
+  columns in order decodes each block once. Because of that cache the reads
+  of a TrajectoryFile must not be done from several threads at the same time.
+ */
+class TrajectoryFile {
+    struct Block {
+        uint64_t firstCol;
+        uint32_t nCols;
+        uint32_t encoding;
+        const char *payload;
+        uint64_t bytes;
+        std::vector<uint64_t> colOffset;    // Start of each column in sparse blocks
+    };
+
+    MappedFile file;
+    TrajFileHeader hdr;
+    TrajFileLayout layout;
+    std::vector<size_t> species;
+    std::vector<Block> blocks;
+    uint64_t nCols=0;                   // Columns actually present in the file
+
+    mutable const Block *cached=nullptr;  // Delta block decoded in cache
+    mutable std::vector<size_t> cache;    // Its counts, column-major
+
+    const Block &BlockOf(size_t col) const;
+    const size_t *Decoded(const Block &b) const;
+    void DecodeRow(const Block &b, size_t row, size_t *out) const;
+
+public:
+    explicit TrajectoryFile(const std::string &fName);
+
+    size_t Rows() const { return hdr.nRows; }
+    size_t Cols() const { return nCols; }
+    size_t Seed() const { return hdr.seed; }
+    uint64_t ModelHash() const { return hdr.modelHash; }
+    size_t CountBytes() const { return hdr.countBytes; }
+
+    /// Species of a row, they differ when only some species were recorded
+    ///
+    size_t SpeciesOf(size_t row) const { return species.empty() ? row : species[row]; }
+
+    /// Evaluation of a column, they differ when recordStart or recordStride
+    /// were used
+    ///
+    size_t EvalOf(size_t col) const { return layout.firstEval + col * layout.evalStride; }
+
+    /// Pointer to a column inside the mapped file, counts are CountBytes()
+    /// wide. Returns nullptr if the column is not stored raw.
+    ///
+    const void *RawColumn(size_t col) const;
+
+    /// Copy the counts of a column to out, that must have Rows() elements
+    ///
+    void ReadColumn(size_t col, size_t *out) const;
+
+    /// Count of one species at one evaluation
+    ///
+    size_t Value(size_t row, size_t col) const;
+
+    /// Abundance of one species over time, sparse columns are searched
+    /// without expanding them
+    ///
+    std::vector<size_t> Series(size_t row) const;
+
+    /// Write the trajectory as tab separated text with one line per species,
+    /// the layout of the tsv output. If only some species or evaluations were
+    /// recorded the first line has the evaluation of each column and every
+    /// line starts with its species.
+    ///
+    void WriteTsv(std::ostream &os) const;
+};
+
+} /* end namespace */
+
+#endif
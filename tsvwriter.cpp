@@ -0,0 +1,106 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "tsvwriter.h"
+
+namespace snim {
+
+// Two digits at a time from a table of "00" to "99"
+//
+static const char digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+char *FormatUnsigned(char *p, uint64_t v){
+    char tmp[maxDigits];
+    char *t = tmp + maxDigits;
+    while (v >= 100) {
+        unsigned i = static_cast<unsigned>(v % 100) * 2;
+        v /= 100;
+        *--t = digitPairs[i + 1];
+        *--t = digitPairs[i];
+    }
+    if (v >= 10) {
+        unsigned i = static_cast<unsigned>(v) * 2;
+        *--t = digitPairs[i + 1];
+        *--t = digitPairs[i];
+    }
+    else
+        *--t = static_cast<char>('0' + v);
+
+    size_t len = tmp + maxDigits - t;
+    std::memcpy(p, t, len);
+    return p + len;
+}
+
+void AppendTsvLine(std::vector<char> &buf, const size_t *values, size_t n, size_t stride){
+    size_t pos = buf.size();
+    buf.resize(pos + n * (maxDigits + 1) + 1);
+    char *p = &buf[pos];
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0)
+            *p++ = '\t';
+        p = FormatUnsigned(p, values[i * stride]);
+    }
+    *p++ = '\n';
+    buf.resize(p - buf.data());
+}
+
+void WriteTsv(std::ostream &os, const matrix<size_t> &m){
+    const size_t rows = m.rows(), cols = m.cols();
+    if (rows == 0 || cols == 0)
+        return;
+
+    // The 16 values of a band in a column take two cache lines, the lines of
+    // the band are kept until the band is complete
+    //
+    const size_t bandRows = 16;
+    const size_t nb = std::min(bandRows, rows);
+    std::vector< std::vector<char> > line(nb, std::vector<char>(cols * (maxDigits + 1)));
+    std::vector<char*> p(nb);
+    const size_t *data = m.data();
+
+    for (size_t r0 = 0; r0 < rows; r0 += bandRows) {
+        size_t nr = std::min(bandRows, rows - r0);
+        for (size_t i = 0; i < nr; ++i)
+            p[i] = line[i].data();
+
+        for (size_t c = 0; c < cols; ++c) {
+            const size_t *col = data + c * rows + r0;
+            for (size_t i = 0; i < nr; ++i) {
+                p[i] = FormatUnsigned(p[i], col[i]);
+                *p[i]++ = '\t';
+            }
+        }
+
+        for (size_t i = 0; i < nr; ++i) {
+            p[i][-1] = '\n';
+            os.write(line[i].data(), p[i] - line[i].data());
+        }
+    }
+}
+
+} // end namespace
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2017 Leonardo A. Saravia <lsaravia@ungs.edu.ar>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+  \file   tsvwriter.h
+  \brief  Fast tab separated output of counts: bulk integer formatting and large writes
+ */
+#ifndef SNIM_TSVWRITER_HH_
+#define SNIM_TSVWRITER_HH_
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+#include "matrix.h"
+
+namespace snim {
+
+/// Longest text of an unsigned 64 bit number
+///
+const size_t maxDigits = 20;
+
+/// Write the decimal digits of v starting at p, that must have room for
+/// maxDigits characters.
+///
+/// \return the position after the last digit
+///
+char *FormatUnsigned(char *p, uint64_t v);
+
+/// Append one tab separated line to a buffer
+///
+/// \param values first value of the line
+/// \param n number of values
+/// \param stride distance between consecutive values in memory
+///
+void AppendTsvLine(std::vector<char> &buf, const size_t *values, size_t n, size_t stride=1);
+
+/// Write a matrix as tab separated text with one line per row, the same text
+/// as operator<<(std::ofstream&, matrix).
+///
+/// The matrix is column-major, so rows are formatted in bands: each column of
+/// the band is contiguous in memory and is spread over the band lines, that
+/// are written with one call when the band is complete.
+///
+void WriteTsv(std::ostream &os, const matrix<size_t> &m);
+
+} /* end namespace */
+
+#endif